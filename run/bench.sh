@@ -0,0 +1,72 @@
+#!/bin/bash
+
+# Runs the simulation several times for each variant of the settings and averages the run summaries.
+# Each variant is a list of config settings separated by ';', appended to config.txt (or to the
+# config file given with -c, e.g. config_stress.txt) for its runs.
+#
+# e.g. ./bench.sh 20 "placement none" "placement spread" "placement pack; watchdog 500"
+#      ./bench.sh -c config_stress.txt 20 ""
+#      ./bench.sh -c config_stress.txt 20 "receptionists 1" "receptionists 2" "receptionists 4"
+#      ./bench.sh -c config_stress.txt 20 "" "elastic 200 2 0; helpers 2" "elastic 200 1 0; elasticage 1000"
+
+base=config.txt
+if [ "$1" = "-c" ]; then
+    base=$2
+    shift 2
+fi
+if [ $# -lt 2 ] || ! [ -f "$base" ]; then
+    echo "USAGE: $0 [-c «config-file»] «number-of-runs» «variant»..."
+    exit 1
+fi
+n=$1
+shift
+if ! [ $n -gt 0 ] 2>/dev/null; then
+    echo "Wrong argument value (\"$n\"). Aborting."
+    exit 1
+fi
+
+cp config.txt config.txt.bench
+trap 'mv -f config.txt.bench config.txt' EXIT
+
+for variant in "$@"
+do
+    if [ "$base" = config.txt ]; then
+        cp config.txt.bench config.txt
+    else
+        cp "$base" config.txt
+    fi
+    echo "$variant" | tr ';' '\n' | sed 's/^ *//' >> config.txt
+    echo -e "\n\e[34;1m$variant\e[0m ($n runs)"
+    for i in $(seq 1 $n)
+    do
+        ./probSemSharedMemRestaurant bench.log 2>bench.err || { echo "run $i failed:" >&2; grep -v "opening log" bench.err >&2; }
+    done | awk -v runs=$n '
+        /^Resource usage per role/ { sec = "ru"; next }
+        /^Latencies/               { sec = "lat"; next }
+        /^Kitchen/                 { sec = "kit"; next }
+        /^Waiter$/                 { sec = "wt"; next }
+        /^Reception$/              { sec = "rt"; next }
+        /^Elastic staffing/        { sec = "el"; next }
+        /^$/                       { sec = ""; next }
+        sec == "ru"  && $1 != "role" && NF >= 9 { cpu[$1] += $3 + $4; cs[$1] += $5 + $6; if (!($1 in ro)) { ro[$1] = ++nr; rname[nr] = $1 } }
+        sec == "lat" && $1 != "latency" && NF == 6 { mean[$1] += $3; p99[$1] += $5; if (!($1 in lo)) { lo[$1] = ++nl; lname[nl] = $1 } }
+        sec == "kit" && /per batch/  { sub(/\(/, "", $6); bsize += $6 }
+        sec == "kit" && /^throughput/ { tput += $2 }
+        sec == "wt" && /per trip/    { sub(/\(/, "", $6); tsize += $6 }
+        sec == "rt" && /^throughput/ { rput += $2 }
+        sec == "el" && /helpers spawned/ { el = 1; helpers += $1 }
+        sec == "el" && /^helper time/ { htime += $3 }
+        END {
+            printf("%-16s %12s %12s\n", "latency", "mean(us)", "p99(us)")
+            for (i = 1; i <= nl; i++)
+                printf("%-16s %12.1f %12.1f\n", lname[i], mean[lname[i]] / runs, p99[lname[i]] / runs)
+            printf("%-16s %12s %12s\n", "role", "cpu(ms)", "ctxsw")
+            for (i = 1; i <= nr; i++)
+                printf("%-16s %12.2f %12.1f\n", rname[i], cpu[rname[i]] / runs, cs[rname[i]] / runs)
+            printf("kitchen: %.2f orders per batch, %.1f orders/s of cooking\n", bsize / runs, tput / runs)
+            printf("waiter: %.2f requests per trip\n", tsize / runs)
+            printf("reception: %.1f requests/s\n", rput / runs)
+            if (el) printf("staffing: %.2f helpers spawned, %.2f ms of helper time\n", helpers / runs, htime / runs)
+        }'
+done
+rm -f bench.log bench.err
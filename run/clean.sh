@@ -6,4 +6,6 @@ rm -f core
 # change 0x61066137 to your semaphore and shared memory key
 ipcrm -S 0x6106b0f5
 ipcrm -M 0x6106b0f5
+# shared block of the monitor implementation (make all_monitor) uses key + 1
+ipcrm -M 0x6106b0f6
 
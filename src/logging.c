@@ -7,7 +7,8 @@
  *
  *  Defined operations:
  *     \li file initialization
- *     \li writing the present full state as a single line at the end of the file.
+ *     \li writing the present full state as a single line at the end of the file
+ *     \li dumping the present full state to an open stream (diagnostics).
  *
  *  \author Nuno Lau - December 2023
  */
@@ -80,6 +81,31 @@ static void printHeader(FILE *fic, FULL_STAT *p_fSt)
     fprintf(fic,"\n");
 }
 
+static void printState(FILE *fic, FULL_STAT *p_fSt)
+{
+    fprintf(fic,"%3d",p_fSt->st.chefStat);
+    fprintf(fic,"%3d",p_fSt->st.waiterStat);
+    fprintf(fic,"%3d",p_fSt->st.receptionistStat);
+    fprintf(fic," ");
+    int g;
+    for(g=0; g < p_fSt->nGroups; g++) {
+        fprintf(fic,"%4d",p_fSt->st.groupStat[g]);
+    }
+
+    fprintf(fic,"%5d",p_fSt->groupsWaiting);
+
+    for(g=0; g < p_fSt->nGroups; g++) {
+        if(p_fSt->assignedTable[g]!=-1)
+            fprintf(fic,"%4d",p_fSt->assignedTable[g]);
+        else {
+            fprintf(fic,"%4s",".");
+        }
+    }
+
+
+    fprintf(fic,"\n");
+}
+
 /* external functions */
 
 /**
@@ -129,28 +155,37 @@ void saveState (char nFic[], FULL_STAT *p_fSt)
 
     fic = openLog(nFic,"a");
 
-    fprintf(fic,"%3d",p_fSt->st.chefStat);
-    fprintf(fic,"%3d",p_fSt->st.waiterStat);
-    fprintf(fic,"%3d",p_fSt->st.receptionistStat);
-    fprintf(fic," ");
-    int g;
-    for(g=0; g < p_fSt->nGroups; g++) {
-        fprintf(fic,"%4d",p_fSt->st.groupStat[g]);
-    }
-
-    fprintf(fic,"%5d",p_fSt->groupsWaiting);
-
-    for(g=0; g < p_fSt->nGroups; g++) {
-        if(p_fSt->assignedTable[g]!=-1)
-            fprintf(fic,"%4d",p_fSt->assignedTable[g]);
-        else {
-            fprintf(fic,"%4s",".");
-        }
-    }
-
-
-    fprintf(fic,"\n");
+    printState(fic, p_fSt);
 
     closeLog(fic);
 }
 
+/**
+ *  \brief Writing the present full state, including the pending requests, to an open stream.
+ *
+ *  Used for diagnostics (e.g. by the watchdog): the header and the state line are written as in the
+ *  logging file, followed by the contents of the request slots.
+ *
+ *  \param fic open stream
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ */
+void dumpState (FILE *fic, FULL_STAT *p_fSt)
+{
+    unsigned int w;
+
+    printHeader(fic, p_fSt);
+    printState(fic, p_fSt);
+
+    fprintf(fic,"receptionistRequest = { %d, %d }  foodOrder = %d  foodGroup = %d\n",
+            p_fSt->receptionistRequest.reqType, p_fSt->receptionistRequest.reqGroup,
+            p_fSt->foodOrder, p_fSt->foodGroup);
+    for (w = 0; w < p_fSt->nWaiters; w++) {
+        fprintf(fic,"zone %u: waiterRequest = { %d, %d }  queued: foodReq = %d  foodReady = %d\n", w,
+                p_fSt->waiterRequest[w].reqType, p_fSt->waiterRequest[w].reqGroup,
+                p_fSt->foodReqQueue[w].count, p_fSt->foodReadyQueue[w].count);
+    }
+    for (w = 0; w < p_fSt->nDishes; w++) {
+        fprintf(fic,"dish %u: queued: orders = %d\n", w, p_fSt->orderQueue[w].count);
+    }
+    fflush(fic);
+}
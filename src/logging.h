@@ -7,7 +7,8 @@
  *
  *  Defined operations:
  *     \li file initialization
- *     \li writing the present full state as a single line at the end of the file.
+ *     \li writing the present full state as a single line at the end of the file
+ *     \li dumping the present full state to an open stream (diagnostics).
  *
  *  \author Nuno Lau - December 2023
  */
@@ -15,6 +16,8 @@
 #ifndef LOGGING_H_
 #define LOGGING_H_
 
+#include <stdio.h>
+
 #include "probDataStruct.h"
 
 /**
@@ -41,4 +44,12 @@ extern void createLog (char nFic[], FULL_STAT *p_fSt);
  */
 extern void saveState (char nFic[], FULL_STAT *p_fSt);
 
+/**
+ *  \brief Writing the present full state, including the pending requests, to an open stream.
+ *
+ *  \param fic open stream
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ */
+extern void dumpState (FILE *fic, FULL_STAT *p_fSt);
+
 #endif /* LOGGING_H_ */
@@ -0,0 +1,202 @@
+/**
+ *  \file metrics.c (implementation file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  \brief Time measurement, entity utilization and time-weighted averages.
+ *
+ *  Defined operations:
+ *     \li reading the monotonic clock
+ *     \li starting, switching and stopping the busy/idle accounting of an entity
+ *     \li starting and updating a time-weighted average and computing its mean
+ *     \li adding a sample to a latency distribution and computing its percentiles.
+ */
+
+#include <stdbool.h>
+#include <time.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "metrics.h"
+
+/* internal functions */
+
+static unsigned int bucketOf(unsigned long long usec)
+{
+    unsigned int e;
+
+    if (usec < 16) {
+        return (unsigned int) usec;
+    }
+    e = 63 - (unsigned int) __builtin_clzll(usec);                                        /* usec in [2^e, 2^(e+1)[ */
+    if (e >= 4 + (LATBUCKETS - 16) / 8) {
+        return LATBUCKETS - 1;
+    }
+    return 16 + (e - 4) * 8 + (unsigned int) ((usec >> (e - 3)) & 7);
+}
+
+static unsigned long long bucketTop(unsigned int b)
+{
+    unsigned int e;
+
+    if (b < 16) {
+        return b;
+    }
+    e = 4 + (b - 16) / 8;
+    return ((8ULL + (b - 16) % 8 + 1) << (e - 3)) - 1;
+}
+
+/* external functions */
+
+/**
+ *  \brief Reading the monotonic clock.
+ *
+ *  CLOCK_MONOTONIC is system wide, so readings of different processes can be compared.
+ *
+ *  \return current time (in microseconds)
+ */
+unsigned long long nowUSec (void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long) ts.tv_sec * 1000000ULL + (unsigned long long) ts.tv_nsec / 1000ULL;
+}
+
+/**
+ *  \brief Starting the busy/idle accounting of an entity (the entity starts idle).
+ *
+ *  \param u utilization record of the entity
+ */
+void utilStart (UTILIZATION *u)
+{
+    u->busyTime = u->idleTime = 0;
+    u->busy = false;
+    u->since = nowUSec();
+}
+
+/**
+ *  \brief Switching an entity between busy and idle.
+ *
+ *  The time elapsed since the last switch is added to the previous condition.
+ *
+ *  \param u utilization record of the entity
+ *  \param busy true if the entity becomes busy, false if it becomes idle
+ */
+void utilBusy (UTILIZATION *u, bool busy)
+{
+    unsigned long long now = nowUSec();
+
+    if (u->busy) {
+        u->busyTime += now - u->since;
+    }
+    else u->idleTime += now - u->since;
+    u->busy = busy;
+    u->since = now;
+}
+
+/**
+ *  \brief Stopping the busy/idle accounting of an entity.
+ *
+ *  \param u utilization record of the entity
+ */
+void utilStop (UTILIZATION *u)
+{
+    utilBusy(u, false);
+}
+
+/**
+ *  \brief Starting a time-weighted average.
+ *
+ *  \param a time-weighted average
+ *  \param value initial value
+ */
+void avgStart (TIMEAVG *a, int value)
+{
+    a->area = 0;
+    a->value = value;
+    a->start = a->since = nowUSec();
+}
+
+/**
+ *  \brief Updating the value of a time-weighted average.
+ *
+ *  The previous value is weighted by the time it lasted.
+ *
+ *  \param a time-weighted average
+ *  \param value new value
+ */
+void avgSet (TIMEAVG *a, int value)
+{
+    unsigned long long now = nowUSec();
+
+    a->area += (unsigned long long) a->value * (now - a->since);
+    a->value = value;
+    a->since = now;
+}
+
+/**
+ *  \brief Mean of a time-weighted average up to a given time.
+ *
+ *  \param a time-weighted average
+ *  \param now end of the averaging period (in microseconds)
+ *
+ *  \return mean value
+ */
+double avgMean (TIMEAVG *a, unsigned long long now)
+{
+    if (now <= a->start) {
+        return a->value;
+    }
+    return (a->area + (double) a->value * (now - a->since)) / (now - a->start);
+}
+
+/**
+ *  \brief Adding a sample to a latency distribution.
+ *
+ *  The update is atomic, so samples may be added concurrently by several processes.
+ *
+ *  \param l latency distribution
+ *  \param usec sample (in microseconds)
+ */
+void latAdd (LATENCY *l, unsigned long long usec)
+{
+    unsigned long long max = __atomic_load_n(&l->max, __ATOMIC_RELAXED);
+
+    __atomic_fetch_add(&l->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&l->sum, usec, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&l->hist[bucketOf(usec)], 1, __ATOMIC_RELAXED);
+    while ((usec > max) && !__atomic_compare_exchange_n(&l->max, &max, usec, true, __ATOMIC_RELAXED,
+                                                        __ATOMIC_RELAXED)) {
+        ;
+    }
+}
+
+/**
+ *  \brief Percentile of a latency distribution.
+ *
+ *  \param l latency distribution
+ *  \param p percentile (0 .. 100)
+ *
+ *  \return upper bound of the histogram bucket holding the percentile (in microseconds)
+ */
+unsigned long long latPercentile (LATENCY *l, double p)
+{
+    unsigned long rank, seen = 0;
+    unsigned int b;
+
+    if (l->count == 0) {
+        return 0;
+    }
+    rank = (unsigned long) (p / 100.0 * l->count + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    for (b = 0; b < LATBUCKETS; b++) {
+        seen += l->hist[b];
+        if (seen >= rank) {
+            return (bucketTop(b) < l->max) ? bucketTop(b) : l->max;
+        }
+    }
+    return l->max;
+}
@@ -0,0 +1,97 @@
+/**
+ *  \file metrics.h (interface file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  \brief Time measurement, entity utilization and time-weighted averages.
+ *
+ *  Defined operations:
+ *     \li reading the monotonic clock
+ *     \li starting, switching and stopping the busy/idle accounting of an entity
+ *     \li starting and updating a time-weighted average and computing its mean
+ *     \li adding a sample to a latency distribution and computing its percentiles.
+ */
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <stdbool.h>
+
+#include "probDataStruct.h"
+
+/**
+ *  \brief Reading the monotonic clock.
+ *
+ *  \return current time (in microseconds)
+ */
+extern unsigned long long nowUSec (void);
+
+/**
+ *  \brief Starting the busy/idle accounting of an entity (the entity starts idle).
+ *
+ *  \param u utilization record of the entity
+ */
+extern void utilStart (UTILIZATION *u);
+
+/**
+ *  \brief Switching an entity between busy and idle.
+ *
+ *  \param u utilization record of the entity
+ *  \param busy true if the entity becomes busy, false if it becomes idle
+ */
+extern void utilBusy (UTILIZATION *u, bool busy);
+
+/**
+ *  \brief Stopping the busy/idle accounting of an entity.
+ *
+ *  \param u utilization record of the entity
+ */
+extern void utilStop (UTILIZATION *u);
+
+/**
+ *  \brief Starting a time-weighted average.
+ *
+ *  \param a time-weighted average
+ *  \param value initial value
+ */
+extern void avgStart (TIMEAVG *a, int value);
+
+/**
+ *  \brief Updating the value of a time-weighted average.
+ *
+ *  \param a time-weighted average
+ *  \param value new value
+ */
+extern void avgSet (TIMEAVG *a, int value);
+
+/**
+ *  \brief Mean of a time-weighted average up to a given time.
+ *
+ *  \param a time-weighted average
+ *  \param now end of the averaging period (in microseconds)
+ *
+ *  \return mean value
+ */
+extern double avgMean (TIMEAVG *a, unsigned long long now);
+
+/**
+ *  \brief Adding a sample to a latency distribution.
+ *
+ *  The update is atomic, so samples may be added concurrently by several processes.
+ *
+ *  \param l latency distribution
+ *  \param usec sample (in microseconds)
+ */
+extern void latAdd (LATENCY *l, unsigned long long usec);
+
+/**
+ *  \brief Percentile of a latency distribution.
+ *
+ *  \param l latency distribution
+ *  \param p percentile (0 .. 100)
+ *
+ *  \return upper bound of the histogram bucket holding the percentile (in microseconds)
+ */
+extern unsigned long long latPercentile (LATENCY *l, double p);
+
+#endif /* METRICS_H_ */
@@ -0,0 +1,92 @@
+/**
+ *  \file perfCounters.c (implementation file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  \brief Hardware performance counters of the calling process (Linux perf events).
+ *
+ *  Counted events (user space only): cycles, instructions, cache misses and branch misses.
+ *  Counters that cannot be opened (no PMU, not permitted by <tt>perf_event_paranoid</tt>, ...)
+ *  are reported as -1, so callers degrade gracefully.
+ *
+ *  Defined operations:
+ *     \li opening and enabling the counters
+ *     \li disabling, reading and closing the counters.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "probConst.h"
+#include "perfCounters.h"
+
+/** \brief perf event of each counter (indexed as PERF_CYCLES .. PERF_BRANCHMISSES) */
+static const unsigned long long event[NUMPERFCOUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES
+};
+
+/** \brief file descriptor of each counter (-1 if not available) */
+static int fd[NUMPERFCOUNTERS] = { -1, -1, -1, -1 };
+
+/* external functions */
+
+/**
+ *  \brief Opening and enabling the counters.
+ *
+ *  Each counter is opened on its own, for the calling process on any cpu, so a missing event does not
+ *  prevent the others from being counted.
+ *
+ *  \return number of counters that could be opened
+ */
+int perfStart (void)
+{
+    struct perf_event_attr attr;
+    int c, n = 0;
+
+    for (c = 0; c < NUMPERFCOUNTERS; c++) {
+        memset(&attr, 0, sizeof (attr));
+        attr.size = sizeof (attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = event[c];
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd[c] = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (fd[c] != -1) {
+            ioctl(fd[c], PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd[c], PERF_EVENT_IOC_ENABLE, 0);
+            n += 1;
+        }
+    }
+
+    return n;
+}
+
+/**
+ *  \brief Disabling, reading and closing the counters.
+ *
+ *  \param count location where the totals are stored (-1 for counters that are not available)
+ */
+void perfStop (long long count[NUMPERFCOUNTERS])
+{
+    int c;
+
+    for (c = 0; c < NUMPERFCOUNTERS; c++) {
+        count[c] = -1;
+        if (fd[c] != -1) {
+            ioctl(fd[c], PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd[c], &count[c], sizeof (count[c])) != sizeof (count[c])) {
+                count[c] = -1;
+            }
+            close(fd[c]);
+            fd[c] = -1;
+        }
+    }
+}
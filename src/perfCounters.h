@@ -0,0 +1,36 @@
+/**
+ *  \file perfCounters.h (interface file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  \brief Hardware performance counters of the calling process (Linux perf events).
+ *
+ *  Counted events (user space only): cycles, instructions, cache misses and branch misses.
+ *  Counters that cannot be opened (no PMU, not permitted by <tt>perf_event_paranoid</tt>, ...)
+ *  are reported as -1, so callers degrade gracefully.
+ *
+ *  Defined operations:
+ *     \li opening and enabling the counters
+ *     \li disabling, reading and closing the counters.
+ */
+
+#ifndef PERFCOUNTERS_H_
+#define PERFCOUNTERS_H_
+
+#include "probConst.h"
+
+/**
+ *  \brief Opening and enabling the counters.
+ *
+ *  \return number of counters that could be opened
+ */
+extern int perfStart (void);
+
+/**
+ *  \brief Disabling, reading and closing the counters.
+ *
+ *  \param count location where the totals are stored (-1 for counters that are not available)
+ */
+extern void perfStop (long long count[NUMPERFCOUNTERS]);
+
+#endif /* PERFCOUNTERS_H_ */
@@ -15,16 +15,68 @@
 
 /** \brief maximum number of groups */
 #define  MAXGROUPS       16 
-/** \brief number of tables */
-#define  NUMTABLES        2 
+/** \brief largest number of tables (sets of tables are bit masks of an unsigned int) */
+#define  MAXTABLES       32
+/** \brief default number of tables */
+#define  DEFTABLES        2
+/** \brief largest capacity of a table and largest group size (size classes are 1 .. MAXSEATS) */
+#define  MAXSEATS        16
+/** \brief default capacity of a table */
+#define  DEFSEATS         4
+/** \brief default size of a group */
+#define  DEFSIZE          2
+/** \brief largest number of receptionists sharing the reception */
+#define  MAXRECEPTIONISTS 4
+/** \brief largest number of waiters, each one serving the tables of its zone */
+#define  MAXWAITERS       4
+/** \brief largest number of dishes on the menu, each one cooked by its own chef */
+#define  MAXDISHES        4
+/** \brief largest number of helpers (extra waiters and chefs) spawned in a run by elastic staffing */
+#define  MAXHELPERS       8
+/** \brief capacity of the request queues (one pending request per group is enough) */
+#define  QUEUESIZE  MAXGROUPS
 /** \brief controls time taken to cook */
 #define  MAXCOOK        100
+/** \brief extra time taken to cook each additional dish of a batch (percentage of one dish) */
+#define  BATCHCOOK       25
+/** \brief largest number of burners of the chef */
+#define  MAXBURNERS       8
+/** \brief number of slots of the timer wheel of the chef */
+#define  WHEELSLOTS      64
+/** \brief time covered by each slot of the timer wheel (in microseconds) */
+#define  WHEELTICK       32
+
+/* Stations of the kitchen pipeline (see semSharedMemChef.c) */
+
+/** \brief prepares the ingredients (uniform service time, PREPMIN to PREPMIN+PREPVAR us) */
+#define  STATION_PREP       0
+/** \brief cooks (service time of the chef, see MAXCOOK and BATCHCOOK) */
+#define  STATION_COOK       1
+/** \brief plates the food and hands it to the waiter (exponential service time, mean PLATEMEAN us) */
+#define  STATION_PLATE      2
+/** \brief number of stations */
+#define  NUMSTATIONS        3
+/** \brief the chef runs the whole kitchen (no pipeline) */
+#define  STATION_ALL        NUMSTATIONS
+/** \brief shortest prep time (in microseconds) */
+#define  PREPMIN           40
+/** \brief spread of the prep time (in microseconds) */
+#define  PREPVAR           40
+/** \brief mean plate time (in microseconds) */
+#define  PLATEMEAN         50
 
 /** \brief controls start time standard deviation */
 #define  STARTDEV         4 
 /** \brief controls eat time standard deviation */
 #define  EATDEV           4 
 
+/** \brief default watchdog timeout on blocking operations (in milliseconds, 0 disables it) */
+#define  WATCHDOGTIME 0
+/** \brief largest watchdog timeout (in milliseconds, so that it still fits a timed down in microseconds) */
+#define  MAXWATCHDOGTIME 4294967U
+
+/** \brief no request (wakeup of the receptionist when the restaurant closes) */
+#define NOREQ      0
 /** \brief id of table request (group->receptionist) */
 #define TABLEREQ   1
 /** \brief id of bill request (group->receptionist) */
@@ -33,6 +85,10 @@
 #define FOODREQ   3
 /** \brief id of food ready (chef->waiter) */
 #define FOODREADY 4
+/** \brief id of renege request, giving up waiting for a table (group->receptionist) */
+#define RENEGEREQ 5
+/** \brief id of table-side checkout notice, tables already released (group->receptionist) */
+#define CHECKOUTNOTE 6
 
 /* Client state constants */
 
@@ -76,5 +132,72 @@
 /** \brief waiter reiceives payment */
 #define  RECVPAY            2
 
+/* Entity ids (used to tell the intervening entities apart in shared bookkeeping) */
+
+/** \brief id of the receptionist */
+#define  RECEPTIONIST_ID    0
+/** \brief id of the waiter */
+#define  WAITER_ID          1
+/** \brief id of the chef (the cook station of the kitchen pipeline) */
+#define  CHEF_ID            2
+/** \brief id of the prep station of the kitchen pipeline */
+#define  PREP_ID            3
+/** \brief id of the plate station of the kitchen pipeline */
+#define  PLATE_ID           4
+/** \brief id of group 0 (group g has id GROUP_ID+g) */
+#define  GROUP_ID           5
+/** \brief id of receptionist 1 (receptionist k > 0 has id RECEPTIONISTS_ID+k-1, receptionist 0 is RECEPTIONIST_ID) */
+#define  RECEPTIONISTS_ID   (GROUP_ID+MAXGROUPS)
+/** \brief id of waiter 1 (the waiter of zone w > 0 has id WAITERS_ID+w-1, the one of zone 0 is WAITER_ID) */
+#define  WAITERS_ID         (RECEPTIONISTS_ID+MAXRECEPTIONISTS-1)
+/** \brief id of chef 1 (the chef of dish d > 0 has id CHEFS_ID+d-1, the one of dish 0 is CHEF_ID) */
+#define  CHEFS_ID           (WAITERS_ID+MAXWAITERS-1)
+/** \brief id of the first helper (helper h, the h-th one spawned by elastic staffing, has id HELPERS_ID+h) */
+#define  HELPERS_ID         (CHEFS_ID+MAXDISHES-1)
+/** \brief number of entity ids */
+#define  NUMENTITIES        (HELPERS_ID+MAXHELPERS)
+
+/* Performance counters (optional, see perfCounters.h) */
+
+/** \brief cpu cycles */
+#define  PERF_CYCLES        0
+/** \brief instructions retired */
+#define  PERF_INSTRUCTIONS  1
+/** \brief last level cache misses */
+#define  PERF_CACHEMISSES   2
+/** \brief mispredicted branches */
+#define  PERF_BRANCHMISSES  3
+/** \brief number of performance counters */
+#define  NUMPERFCOUNTERS    4
+
+/* Latencies measured by the entities (see metrics.h) */
+
+/** \brief table request issued until table assigned */
+#define  LAT_CHECKIN        0
+/** \brief food request issued until acknowledged by the waiter */
+#define  LAT_FOODACK        1
+/** \brief food request issued until food arrived */
+#define  LAT_FOOD           2
+/** \brief bill request issued until payment acknowledged, or table-side checkout until the tables are freed */
+#define  LAT_CHECKOUT       3
+/** \brief food cooked until taken to the table (measured by the waiter) */
+#define  LAT_SERVE          4
+/** \brief food request queued to the chef until cooked (measured by the chef) */
+#define  LAT_KITCHEN        5
+/** \brief number of latencies */
+#define  NUMLATENCIES       6
+/** \brief number of histogram buckets of a latency (16 exact, then 8 per power of two) */
+#define  LATBUCKETS       272
+
+/* Placement policies of the entity processes (see probSemSharedMemRestaurant.c) */
+
+/** \brief processes are left to the scheduler */
+#define  PLACE_NONE         0
+/** \brief service roles on dedicated cores, groups spread over the other cores */
+#define  PLACE_SPREAD       1
+/** \brief service roles on dedicated cores, groups packed on one of the other cores */
+#define  PLACE_PACK         2
+/** \brief all processes on a single core */
+#define  PLACE_SINGLE       3
 
 #endif /* PROBCONST_H_ */
@@ -25,8 +25,65 @@ typedef struct {
     int reqType;
     /** \brief group that issues the request (dummy if request source is chef) */
     int reqGroup;
+    /** \brief dish ordered (food requests only) */
+    int reqDish;
 } request;
 
+/**
+ *  \brief Definition of a bounded FIFO queue of requests (operated within the critical region)
+ */
+typedef struct {
+    /** \brief position of the oldest request */
+    int head;
+    /** \brief number of queued requests */
+    int count;
+    /** \brief queued requests */
+    request item[QUEUESIZE];
+} REQQUEUE;
+
+
+/**
+ *  \brief Definition of busy/idle accounting of an entity (times in microseconds)
+ */
+typedef struct {
+    /** \brief total time spent busy */
+    unsigned long long busyTime;
+    /** \brief total time spent idle (waiting) */
+    unsigned long long idleTime;
+    /** \brief time of the last switch */
+    unsigned long long since;
+    /** \brief entity is busy */
+    bool busy;
+} UTILIZATION;
+
+/**
+ *  \brief Definition of time-weighted average of an integer quantity (times in microseconds)
+ */
+typedef struct {
+    /** \brief integral of the value over time up to since */
+    unsigned long long area;
+    /** \brief start of the averaging period */
+    unsigned long long start;
+    /** \brief time of the last change */
+    unsigned long long since;
+    /** \brief current value */
+    int value;
+} TIMEAVG;
+
+/**
+ *  \brief Definition of latency distribution (times in microseconds)
+ */
+typedef struct {
+    /** \brief number of samples */
+    unsigned long count;
+    /** \brief sum of the samples */
+    unsigned long long sum;
+    /** \brief largest sample */
+    unsigned long long max;
+    /** \brief log-linear histogram of the samples */
+    unsigned long hist[LATBUCKETS];
+} LATENCY;
+
 
 /**
  *  \brief Definition of <em>state of the intervening entities</em> data type.
@@ -60,21 +117,115 @@ typedef struct
     int startTime[MAXGROUPS];
     /** \brief estimated eat time of groups */
     int eatTime[MAXGROUPS];
+    /** \brief number of people of each group */
+    int groupSize[MAXGROUPS];
+    /** \brief largest number of groups waiting for a table each group accepts to join (-1 if any) */
+    int tolerance[MAXGROUPS];
+    /** \brief time (in microseconds) each group waits for a table before leaving (0 if forever) */
+    int patience[MAXGROUPS];
+    /** \brief number of tables */
+    int nTables;
+    /** \brief number of seats of each table */
+    int tableSeats[MAXTABLES];
+    /** \brief tables next to each table, which may be pushed together with it (one bit per table) */
+    unsigned int adjacent[MAXTABLES];
+    /** \brief start of the arrival window of the reservation of each group (in microseconds since the
+        restaurant opened, -1 for a walk-in group) */
+    int resvFrom[MAXGROUPS];
+    /** \brief end of the arrival window of the reservation of each group (in microseconds since the
+        restaurant opened) */
+    int resvUntil[MAXGROUPS];
+    /** \brief table booked by each group (-1 if the reservation is by size) */
+    int resvTable[MAXGROUPS];
+    /** \brief number of seats booked by each group (when the reservation is by size) */
+    int resvSeats[MAXGROUPS];
+    /** \brief time (in microseconds) a table is held ahead of the arrival window of its reservation */
+    unsigned int holdLead;
+    /** \brief time (in microseconds) a table is held past the arrival window before the reservation is dropped */
+    unsigned int holdGrace;
+
+    /** \brief time (in milliseconds) an entity may stay blocked on a semaphore before a stall is reported (0 disables it) */
+    unsigned int watchdogTimeout;
+    /** \brief an entity that reports a stall terminates, failing the run (otherwise it goes on waiting) */
+    bool watchdogAbort;
+    /** \brief entities count hardware events around their life cycle */
+    bool perfCounters;
+    /** \brief placement policy of the entity processes on the cpus */
+    int placement;
+    /** \brief largest number of spin iterations before a down blocks (0 disables spinning) */
+    unsigned int spinMax;
+    /** \brief waiter front end waits on eventfds (epoll) instead of the waiterRequest semaphore */
+    bool waiterEvents;
+    /** \brief largest number of orders the chef cooks as one batch (1 disables batching) */
+    unsigned int batchSize;
+    /** \brief time the chef waits for further orders to fill a batch (in microseconds) */
+    unsigned int batchWindow;
+    /** \brief number of batches the chef can cook at the same time */
+    unsigned int burners;
+    /** \brief the kitchen is a pipeline of stations (prep, cook, plate), one process each */
+    bool pipeline;
+    /** \brief capacity of the queues between stations */
+    unsigned int stationQueueSize;
+    /** \brief largest number of requests the waiter serves in one trip (1 serves them one at a time) */
+    unsigned int tripSize;
+    /** \brief number of courses of every meal (each one ordered, waited for and eaten in turn) */
+    unsigned int courses;
+    /** \brief number of receptionists, taking the requests of the groups from the same slot */
+    unsigned int nReceptionists;
+    /** \brief groups check out at their table, releasing it without going through the request slot */
+    bool selfCheckout;
+    /** \brief number of waiters, one per zone of the floor */
+    unsigned int nWaiters;
+    /** \brief zone of each table, whose waiter serves the groups seated at it */
+    int tableZone[MAXTABLES];
+    /** \brief an idle waiter takes work queued to the waiter of the busiest other zone (event front end) */
+    bool steal;
+    /** \brief number of dishes on the menu, each one cooked by its own chef */
+    unsigned int nDishes;
+    /** \brief dish of the first course of each group (each further course is the next dish on the menu) */
+    int firstDish[MAXGROUPS];
+    /** \brief time taken to cook each dish (percentage of the time of one dish, see MAXCOOK) */
+    unsigned int dishCook[MAXDISHES];
+    /** \brief time between two samples of the queues by the generator, which staffs them elastically (in
+        microseconds, 0 disables elastic staffing) */
+    unsigned int elasticPeriod;
+    /** \brief number of requests queued to a zone or dish at which a helper is spawned for it */
+    int elasticUp;
+    /** \brief number of requests queued to a zone or dish at or below which one of its helpers is retired */
+    int elasticDown;
+    /** \brief time the oldest request queued to a zone or dish may wait before a helper is spawned for it (in
+        microseconds, 0 if only the number of requests counts) */
+    unsigned int elasticAge;
+    /** \brief largest number of helpers working for the same zone or dish at the same time */
+    unsigned int maxHelpers;
+    /** \brief number of helpers spawned so far (entity ids HELPERS_ID onwards) */
+    unsigned int nHelpers;
 
     /** \brief saves the table that is being used by each group */
     int assignedTable[MAXGROUPS];
+    /** \brief tables taken by each group, combined when one is not enough (one bit per table, 0 if none) */
+    unsigned int tableSet[MAXGROUPS];
 
-    /** \brief flag of food request from waiter to chef */
+    /** \brief number of food requests queued by waiter to chef and not yet taken */
     int foodOrder;
-    /** \brief group associated to food request from waiter to chef */
+    /** \brief group associated to the last food request queued by waiter to chef */
     int foodGroup;
+    /** \brief food requests queued by waiter to the chef of each dish (input of the first station of the pipeline) */
+    REQQUEUE orderQueue[MAXDISHES];
+    /** \brief input queue of each station of the pipeline but the first (bounded by stationQueueSize) */
+    REQQUEUE stationQueue[NUMSTATIONS];
 
 
     /** \brief used by groups to store request to receptionist */
     request receptionistRequest;
 
-    /** \brief used by groups and chef to store request to waiter */
-    request waiterRequest;
+    /** \brief used by groups to store request to the waiter of each zone */
+    request waiterRequest[MAXWAITERS];
+
+    /** \brief food requests of the groups to the waiter of each zone (event front end) */
+    REQQUEUE foodReqQueue[MAXWAITERS];
+    /** \brief food ready notices of the chef to the waiter of each zone (served before the food requests) */
+    REQQUEUE foodReadyQueue[MAXWAITERS];
 
 
 } FULL_STAT;
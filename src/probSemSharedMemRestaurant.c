@@ -11,18 +11,94 @@
  *  Upon execution, one parameter is requested:
  *    \li name of the logging file.
  *
+ *  The config file holds the number of groups and one line per group (start time, eat time and,
+ *  optionally, number of people, DEFSIZE by default, largest number of groups waiting for a table the
+ *  group accepts to join, -1 by default for any, and time in microseconds it waits for a table before
+ *  leaving, 0 by default for forever), optionally followed by settings, one per line, as
+ *  <tt>name value</tt>:
+ *    \li <tt>reserve</tt> reservation of a group, as <tt>reserve group from until table t</tt> or
+ *        <tt>reserve group from until size n</tt>: the group books table t, or the tables that best fit n
+ *        people, for an arrival between from and until (in microseconds since the restaurant opened);
+ *        groups without one walk in
+ *    \li <tt>hold</tt> hold policy of the reservations, as <tt>hold lead grace</tt>: tables are held from lead
+ *        microseconds before the arrival window (or the arrival of the group, if earlier) and released grace
+ *        microseconds after it if the group has not arrived, the group then walking in (0 and 0 by default)
+ *    \li <tt>tables</tt> number of seats of each table, as a list on the same line (DEFTABLES tables of
+ *        DEFSEATS seats by default, up to MAXTABLES tables of MAXSEATS seats)
+ *    \li <tt>adjacent</tt> tables, as a list on the same line, standing in a row: each one may be pushed
+ *        together with the next to seat a large group (may be given several times; no table is adjacent to
+ *        another by default); every group must fit a table or a row of adjacent ones
+ *    \li <tt>watchdog</tt> time (in milliseconds, up to MAXWATCHDOGTIME) an entity may stay blocked before a
+ *        stall is reported (0, the default, disables stall detection), optionally followed by <tt>report</tt>
+ *        (the default: the entity dumps the state and goes on waiting) or <tt>abort</tt> (the entity
+ *        terminates and the run fails); it must exceed the longest start and eat times of the groups
+ *    \li <tt>perf</tt> 1 to have every entity count hardware events (cycles, instructions, cache and
+ *        branch misses) around its life cycle, reported per role at the end of the run
+ *    \li <tt>placement</tt> cpu placement of the processes: <tt>none</tt> (scheduler decides),
+ *        <tt>spread</tt> or <tt>pack</tt> (service roles on dedicated cpus, groups spread over or packed on
+ *        the remaining ones) or <tt>single</tt> (everything on one cpu)
+ *    \li <tt>spin</tt> largest number of iterations a down spins before blocking (0, the default, blocks at once)
+ *    \li <tt>waiter</tt> front end of the waiter: <tt>sem</tt> (the default, one request at a time through
+ *        the waiterRequest semaphore) or <tt>epoll</tt> (groups and chef queue their requests and notify the
+ *        waiter through eventfds, the waiter multiplexes them with epoll)
+ *    \li <tt>batch</tt> largest number of orders the chef cooks together (1, the default, cooks one at a time)
+ *    \li <tt>batchwindow</tt> time (in microseconds) the chef waits for further orders to fill a batch
+ *        (0, the default, only takes the orders already queued)
+ *    \li <tt>burners</tt> number of batches the chef keeps cooking at the same time (1, the default, up to
+ *        MAXBURNERS); the chef takes new orders while a burner is free
+ *    \li <tt>pipeline</tt> 1 to run the kitchen as a pipeline of prep, cook and plate stations, one process
+ *        each, connected by bounded queues (the chef settings above apply to the cook station)
+ *    \li <tt>stationqueue</tt> capacity of the queues between stations (2 by default, up to QUEUESIZE)
+ *    \li <tt>trip</tt> largest number of requests (food to deliver first, then orders to take) the waiter serves
+ *        in one pass (1, the default, serves them one at a time)
+ *    \li <tt>courses</tt> number of courses of every meal (1 by default): the group orders, waits for and eats
+ *        each one in turn, the eat time of the group being split evenly among them
+ *    \li <tt>receptionists</tt> number of receptionists (1, the default, up to MAXRECEPTIONISTS): each one takes
+ *        the next request of the groups and they share the seating state
+ *    \li <tt>waiters</tt> number of waiters (1, the default, up to MAXWAITERS): the floor is divided into as
+ *        many zones, each waiter serving the tables of its zone through its own request channel
+ *    \li <tt>zones</tt> zone of each table, as a list on the same line (by default, the tables are split into
+ *        blocks of consecutive ones, one per zone)
+ *    \li <tt>steal</tt> 1 to let a waiter with nothing to do take requests queued to the waiter of the busiest
+ *        other zone (needs the <tt>epoll</tt> front end, whose queues can be taken from by any waiter)
+ *    \li <tt>dishes</tt> number of dishes on the menu (1, the default, up to MAXDISHES), each one cooked by its
+ *        own chef from its own order queue, to which the waiter routes the orders of the dish (not with the
+ *        <tt>pipeline</tt>)
+ *    \li <tt>menu</tt> dish of the first course of each group, as a list on the same line (by default, group g
+ *        starts with dish g modulo the number of dishes); each further course is the next dish on the menu
+ *    \li <tt>dishcook</tt> time taken to cook each dish, as a list on the same line of percentages of the time
+ *        of one dish (100 by default)
+ *    \li <tt>elastic</tt> elastic staffing, as <tt>elastic period up down</tt>: every period microseconds the
+ *        generator samples the requests queued to each zone (with the <tt>sem</tt> front end) and to each dish
+ *        (without the <tt>pipeline</tt>); it spawns a helper, a waiter or chef sharing their channel, when up
+ *        requests or more are queued and retires the newest helper when down or fewer are (disabled by default,
+ *        up must exceed down)
+ *    \li <tt>elasticage</tt> time (in microseconds) the oldest request queued to a zone or dish may wait before a
+ *        helper is spawned for it, however few are queued (0, the default, only counts the requests)
+ *    \li <tt>helpers</tt> largest number of helpers of the same zone or dish at a time (1 by default); at most
+ *        MAXHELPERS are spawned in a run
+ *    \li <tt>checkout</tt> how groups check out: <tt>desk</tt> (the default, a bill request to the receptionist,
+ *        waiting for the payment to be acknowledged) or <tt>self</tt> (at the table: the group marks itself gone
+ *        with an atomic operation and leaves, the receptionist being notified to free its tables and seat the
+ *        groups waiting; the check-out then lasts until the tables are freed).
+ *
  *  \author Nuno Lau - December 2023
  */
 
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <unistd.h>
 #include <sys/wait.h>
 #include <sys/types.h>
+#include <sys/resource.h>
 #include <sys/ipc.h>
+#include <sys/eventfd.h>
 #include <string.h>
 #include <math.h>
+#include <sched.h>
 
 #include "probConst.h"
 #include "probDataStruct.h"
@@ -30,6 +106,10 @@
 #include "sharedDataSync.h"
 #include "semaphore.h"
 #include "sharedMemory.h"
+#include "watchdog.h"
+#include "report.h"
+#include "metrics.h"
+#include "requestQueue.h"
 
 /** \brief name of chef process */
 #define   CHEF               "./chef"
@@ -42,6 +122,594 @@
 
 /** \brief name of chef process */
 #define   RECEPTIONIST       "./receptionist"
+
+/** \brief number of roles in the run summary (receptionist, waiter, chef and groups aggregated) */
+#define   NROLES             (GROUP_ID+1)
+
+/** \brief name of each role in the run summary (indexed by entity id, groups share the last one) */
+static char *roleName[NROLES] = { "RT", "WT", "CH", "PR", "PL", "GR" };
+
+/** \brief entity id of each station of the kitchen pipeline */
+static unsigned int stationId[NUMSTATIONS] = { PREP_ID, CHEF_ID, PLATE_ID };
+
+/** \brief name of each station of the kitchen pipeline */
+static char *stationName[NUMSTATIONS] = { "prep", "cook", "plate" };
+
+/** \brief name of each latency in the run summary (indexed as LAT_CHECKIN .. ) */
+static char *latencyName[NUMLATENCIES] = { "check-in", "food-ack", "time-to-food", "check-out",
+                                            "cooked-to-table", "order-to-cooked" };
+
+/** \brief process identifier of each helper spawned by elastic staffing */
+static int helperPid[MAXHELPERS];
+
+/** \brief role of each helper (WAITER_ID or CHEF_ID) */
+static unsigned int helperRole[MAXHELPERS];
+
+/** \brief zone (waiters) or dish (chefs) each helper works for */
+static int helperOf[MAXHELPERS];
+
+/** \brief each helper is working (spawned and not retired) */
+static bool helperWorking[MAXHELPERS];
+
+/** \brief number of helpers working */
+static unsigned int nWorking;
+
+/** \brief largest number of helpers working at the same time */
+static unsigned int peakWorking;
+
+/** \brief number of helpers retired */
+static unsigned int nRetired;
+
+/**
+ *  \brief Role of an entity in the run summary.
+ *
+ *  \param entity entity id
+ *
+ *  \return index of the role in roleName
+ */
+static unsigned int roleOf (unsigned int entity)
+{
+    if (entity < GROUP_ID) return entity;
+    if (entity >= HELPERS_ID) return helperRole[entity - HELPERS_ID];
+    if (entity >= CHEFS_ID) return CHEF_ID;
+    if (entity >= WAITERS_ID) return WAITER_ID;
+    if (entity >= RECEPTIONISTS_ID) return RECEPTIONIST_ID;
+    return GROUP_ID;
+}
+
+/**
+ *  \brief Tables adjacent to any of a set of tables.
+ *
+ *  \param p_fSt pointer to the full state of the problem
+ *  \param set set of tables (one bit per table)
+ *
+ *  \return tables adjacent to some table of the set (one bit per table)
+ */
+static unsigned int adjacentTo (FULL_STAT *p_fSt, unsigned int set)
+{
+    unsigned int adj = 0;
+    int t;
+
+    for (t = 0; t < p_fSt->nTables; t++) {
+        if (set & (1U << t)) adj |= p_fSt->adjacent[t];
+    }
+    return adj;
+}
+
+/**
+ *  \brief Checks whether another value follows on the current line of the config file.
+ *
+ *  \param fp config file
+ *
+ *  \return true if the line goes on, false at its end
+ */
+static bool moreOnLine (FILE *fp)
+{
+    int c;
+
+    do {
+        c = fgetc (fp);
+    } while ((c == ' ') || (c == '\t'));
+    if (c != EOF) {
+        ungetc (c, fp);
+    }
+    return (c != EOF) && (c != '\n') && (c != '\r');
+}
+
+/**
+ *  \brief Parsing of an optional setting of the config file.
+ *
+ *  Settings follow the group lines, one per line, as <tt>name value</tt>.
+ *
+ *  \param fp config file
+ *  \param name setting name
+ *  \param p_fSt pointer to the full state of the problem
+ *
+ *  \return true if the setting is known and its value was read, false otherwise
+ */
+static bool parseOption (FILE *fp, char name[], FULL_STAT *p_fSt)
+{
+    int value, t, prev, g, from, until;
+    char policy[8];
+
+    if (strcmp (name, "watchdog") == 0) {
+        if ((fscanf (fp, "%u", &p_fSt->watchdogTimeout) != 1) || (p_fSt->watchdogTimeout > MAXWATCHDOGTIME))
+            return false;
+        if (!moreOnLine (fp))
+            return true;
+        if (fscanf (fp, "%7s", policy) != 1)
+            return false;
+        if (strcmp (policy, "report") == 0) p_fSt->watchdogAbort = false;
+        else if (strcmp (policy, "abort") == 0) p_fSt->watchdogAbort = true;
+        else return false;
+        return true;
+    }
+    if (strcmp (name, "perf") == 0) {
+        if (fscanf (fp, "%d", &value) != 1)
+            return false;
+        p_fSt->perfCounters = (value != 0);
+        return true;
+    }
+    if (strcmp (name, "spin") == 0)
+        return fscanf (fp, "%u", &p_fSt->spinMax) == 1;
+    if (strcmp (name, "placement") == 0) {
+        if (fscanf (fp, "%7s", policy) != 1)
+            return false;
+        if (strcmp (policy, "none") == 0) p_fSt->placement = PLACE_NONE;
+        else if (strcmp (policy, "spread") == 0) p_fSt->placement = PLACE_SPREAD;
+        else if (strcmp (policy, "pack") == 0) p_fSt->placement = PLACE_PACK;
+        else if (strcmp (policy, "single") == 0) p_fSt->placement = PLACE_SINGLE;
+        else return false;
+        return true;
+    }
+    if (strcmp (name, "batch") == 0)
+        return (fscanf (fp, "%u", &p_fSt->batchSize) == 1) && (p_fSt->batchSize >= 1);
+    if (strcmp (name, "batchwindow") == 0)
+        return fscanf (fp, "%u", &p_fSt->batchWindow) == 1;
+    if (strcmp (name, "burners") == 0)
+        return (fscanf (fp, "%u", &p_fSt->burners) == 1) && (p_fSt->burners >= 1) &&
+               (p_fSt->burners <= MAXBURNERS);
+    if (strcmp (name, "pipeline") == 0) {
+        if (fscanf (fp, "%d", &value) != 1)
+            return false;
+        p_fSt->pipeline = (value != 0);
+        return true;
+    }
+    if (strcmp (name, "stationqueue") == 0)
+        return (fscanf (fp, "%u", &p_fSt->stationQueueSize) == 1) && (p_fSt->stationQueueSize >= 1) &&
+               (p_fSt->stationQueueSize <= QUEUESIZE);
+    if (strcmp (name, "trip") == 0)
+        return (fscanf (fp, "%u", &p_fSt->tripSize) == 1) && (p_fSt->tripSize >= 1) &&
+               (p_fSt->tripSize <= MAXGROUPS);
+    if (strcmp (name, "tables") == 0) {
+        for (p_fSt->nTables = 0; moreOnLine (fp); p_fSt->nTables++) {
+            if ((p_fSt->nTables == MAXTABLES) || (fscanf (fp, "%d", &p_fSt->tableSeats[p_fSt->nTables]) != 1) ||
+                (p_fSt->tableSeats[p_fSt->nTables] < 1) || (p_fSt->tableSeats[p_fSt->nTables] > MAXSEATS))
+                return false;
+        }
+        return p_fSt->nTables > 0;
+    }
+    if (strcmp (name, "adjacent") == 0) {
+        for (prev = -1; moreOnLine (fp); prev = t) {
+            if ((fscanf (fp, "%d", &t) != 1) || (t < 0) || (t >= MAXTABLES) || (t == prev))
+                return false;
+            if (prev != -1) {
+                p_fSt->adjacent[prev] |= 1U << t;
+                p_fSt->adjacent[t] |= 1U << prev;
+            }
+        }
+        return prev != -1;
+    }
+    if (strcmp (name, "reserve") == 0) {
+        if ((fscanf (fp, "%d %d %d %7s %d", &g, &from, &until, policy, &value) != 5) || (g < 0) ||
+            (g >= p_fSt->nGroups) || (from < 0) || (until < from))
+            return false;
+        p_fSt->resvFrom[g] = from;
+        p_fSt->resvUntil[g] = until;
+        p_fSt->resvTable[g] = -1;
+        if (strcmp (policy, "table") == 0) {
+            p_fSt->resvTable[g] = value;
+            return (value >= 0) && (value < MAXTABLES);
+        }
+        p_fSt->resvSeats[g] = value;
+        return (strcmp (policy, "size") == 0) && (value >= 1) && (value <= MAXSEATS);
+    }
+    if (strcmp (name, "hold") == 0)
+        return fscanf (fp, "%u %u", &p_fSt->holdLead, &p_fSt->holdGrace) == 2;
+    if (strcmp (name, "courses") == 0)
+        return (fscanf (fp, "%u", &p_fSt->courses) == 1) && (p_fSt->courses >= 1);
+    if (strcmp (name, "receptionists") == 0)
+        return (fscanf (fp, "%u", &p_fSt->nReceptionists) == 1) && (p_fSt->nReceptionists >= 1) &&
+               (p_fSt->nReceptionists <= MAXRECEPTIONISTS);
+    if (strcmp (name, "waiters") == 0)
+        return (fscanf (fp, "%u", &p_fSt->nWaiters) == 1) && (p_fSt->nWaiters >= 1) &&
+               (p_fSt->nWaiters <= MAXWAITERS);
+    if (strcmp (name, "steal") == 0) {
+        if (fscanf (fp, "%d", &value) != 1)
+            return false;
+        p_fSt->steal = (value != 0);
+        return true;
+    }
+    if (strcmp (name, "zones") == 0) {
+        for (t = 0; moreOnLine (fp); t++) {
+            if ((t == MAXTABLES) || (fscanf (fp, "%d", &p_fSt->tableZone[t]) != 1) ||
+                (p_fSt->tableZone[t] < 0) || (p_fSt->tableZone[t] >= MAXWAITERS))
+                return false;
+        }
+        return t > 0;
+    }
+    if (strcmp (name, "dishes") == 0)
+        return (fscanf (fp, "%u", &p_fSt->nDishes) == 1) && (p_fSt->nDishes >= 1) &&
+               (p_fSt->nDishes <= MAXDISHES);
+    if (strcmp (name, "menu") == 0) {
+        for (g = 0; moreOnLine (fp); g++) {
+            if ((g == MAXGROUPS) || (fscanf (fp, "%d", &p_fSt->firstDish[g]) != 1) ||
+                (p_fSt->firstDish[g] < 0) || (p_fSt->firstDish[g] >= MAXDISHES))
+                return false;
+        }
+        return g > 0;
+    }
+    if (strcmp (name, "dishcook") == 0) {
+        for (t = 0; moreOnLine (fp); t++) {
+            if ((t == MAXDISHES) || (fscanf (fp, "%u", &p_fSt->dishCook[t]) != 1) || (p_fSt->dishCook[t] < 1))
+                return false;
+        }
+        return t > 0;
+    }
+    if (strcmp (name, "elastic") == 0)
+        return (fscanf (fp, "%u %d %d", &p_fSt->elasticPeriod, &p_fSt->elasticUp, &p_fSt->elasticDown) == 3) &&
+               (p_fSt->elasticPeriod > 0) && (p_fSt->elasticDown >= 0) && (p_fSt->elasticUp > p_fSt->elasticDown);
+    if (strcmp (name, "elasticage") == 0)
+        return fscanf (fp, "%u", &p_fSt->elasticAge) == 1;
+    if (strcmp (name, "helpers") == 0)
+        return (fscanf (fp, "%u", &p_fSt->maxHelpers) == 1) && (p_fSt->maxHelpers >= 1) &&
+               (p_fSt->maxHelpers <= MAXHELPERS);
+    if (strcmp (name, "checkout") == 0) {
+        if (fscanf (fp, "%7s", policy) != 1)
+            return false;
+        if (strcmp (policy, "desk") == 0) p_fSt->selfCheckout = false;
+        else if (strcmp (policy, "self") == 0) p_fSt->selfCheckout = true;
+        else return false;
+        return true;
+    }
+    if (strcmp (name, "waiter") == 0) {
+        if (fscanf (fp, "%7s", policy) != 1)
+            return false;
+        if (strcmp (policy, "sem") == 0) p_fSt->waiterEvents = false;
+        else if (strcmp (policy, "epoll") == 0) p_fSt->waiterEvents = true;
+        else return false;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ *  \brief Reading the config file.
+ *
+ *  \param p_fSt pointer to the full state of the problem, where the settings are stored
+ */
+static void readConfig (FULL_STAT *p_fSt)
+{
+    char opt[32];                                                                         /* name of optional setting */
+    int g, t, seats, most;
+    unsigned int row, next;
+
+    FILE *fp = fopen("config.txt","r");
+    if(fp==NULL) {
+        perror("Could not open config file");
+        exit(EXIT_FAILURE);
+    }
+
+    /* parse config file */
+    fscanf(fp,"%*[^\n]");
+    fscanf(fp,"%d ",&p_fSt->nGroups);
+    fscanf(fp,"%*[^\n]");
+    for(g=0;g < p_fSt->nGroups;g++) {
+       fscanf(fp,"%d %d", &p_fSt->startTime[g], &p_fSt->eatTime[g]);
+       p_fSt->groupSize[g] = DEFSIZE;
+       p_fSt->tolerance[g] = -1;
+       p_fSt->patience[g] = 0;
+       if ((moreOnLine(fp) && (fscanf(fp,"%d", &p_fSt->groupSize[g]) != 1)) ||
+           (moreOnLine(fp) && (fscanf(fp,"%d", &p_fSt->tolerance[g]) != 1)) ||
+           (moreOnLine(fp) && ((fscanf(fp,"%d", &p_fSt->patience[g]) != 1) || (p_fSt->patience[g] < 0)))) {
+           fprintf(stderr,"Wrong line of group %d in config file\n", g);
+           exit(EXIT_FAILURE);
+       }
+    }
+    /* optional settings, until the end of the file */
+    while (fscanf(fp," %31s",opt) == 1) {
+        if (opt[0] == '#') {
+            fscanf(fp,"%*[^\n]");
+        }
+        else if (!parseOption(fp, opt, p_fSt)) {
+            fprintf(stderr,"Wrong setting %s in config file\n", opt);
+            exit(EXIT_FAILURE);
+        }
+    }
+    fclose(fp);
+
+    if (p_fSt->steal && !p_fSt->waiterEvents) {
+        fprintf(stderr,"Waiters can only steal requests with the epoll front end\n");
+        exit(EXIT_FAILURE);
+    }
+    if ((p_fSt->nDishes > 1) && p_fSt->pipeline) {
+        fprintf(stderr,"Several dishes can only be cooked without the pipeline\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* groups without a first dish start the menu at different dishes */
+    for(g=0;g < p_fSt->nGroups;g++) {
+       if (p_fSt->firstDish[g] < 0) {
+           p_fSt->firstDish[g] = g % (int) p_fSt->nDishes;
+       }
+       else if (p_fSt->firstDish[g] >= (int) p_fSt->nDishes) {
+           fprintf(stderr,"Group %d orders a dish that is not on the menu\n", g);
+           exit(EXIT_FAILURE);
+       }
+    }
+
+    /* tables without a zone are split into blocks of consecutive ones */
+    for(t=0;t < p_fSt->nTables;t++) {
+       if (p_fSt->tableZone[t] < 0) {
+           p_fSt->tableZone[t] = t * (int) p_fSt->nWaiters / p_fSt->nTables;
+       }
+       else if (p_fSt->tableZone[t] >= (int) p_fSt->nWaiters) {
+           fprintf(stderr,"Table %d is in a zone without a waiter\n", t);
+           exit(EXIT_FAILURE);
+       }
+    }
+
+    /* every group must fit a table or a row of adjacent ones, or it would wait forever */
+    for(most=0,t=0;t < p_fSt->nTables;t++) {
+       if ((p_fSt->nTables < MAXTABLES) && (p_fSt->adjacent[t] >> p_fSt->nTables)) {
+           fprintf(stderr,"Table %d is adjacent to a table that does not exist\n", t);
+           exit(EXIT_FAILURE);
+       }
+       for (row = 1U << t; (next = row | adjacentTo(p_fSt, row)) != row; row = next);
+       for (seats = 0, g = 0; g < p_fSt->nTables; g++) {
+           if (row & (1U << g)) seats += p_fSt->tableSeats[g];
+       }
+       if (seats > most) most = seats;
+    }
+    for(g=0;g < p_fSt->nGroups;g++) {
+       if ((p_fSt->resvFrom[g] >= 0) &&
+           ((p_fSt->resvTable[g] >= 0) ? (p_fSt->resvTable[g] >= p_fSt->nTables) ||
+                                         (p_fSt->tableSeats[p_fSt->resvTable[g]] < p_fSt->groupSize[g])
+                                       : (p_fSt->resvSeats[g] < p_fSt->groupSize[g]))) {
+           fprintf(stderr,"Group %d booked a table that does not exist or is too small\n", g);
+           exit(EXIT_FAILURE);
+       }
+       if ((p_fSt->groupSize[g] < 1) || (p_fSt->groupSize[g] > most)) {
+           fprintf(stderr,"Group %d does not fit any table\n", g);
+           exit(EXIT_FAILURE);
+       }
+    }
+}
+
+/** \brief cpus the run may use (affinity of the generator at startup) */
+static cpu_set_t runCpus;
+
+/** \brief ids of the cpus the run may use */
+static int cpuList[CPU_SETSIZE];
+
+/** \brief number of cpus the run may use */
+static int nCpus;
+
+/** \brief number of service roles of the run (the prep and plate stations only run with the pipeline) */
+static int nRoles;
+
+/** \brief number of service processes (roles, extra receptionists, waiters and chefs), which take the first cpus */
+static int nServices;
+
+/** \brief number of extra receptionists, whose cpus come before those of the extra waiters */
+static int nExtraReceptionists;
+
+/** \brief number of extra waiters, whose cpus come before those of the extra chefs */
+static int nExtraWaiters;
+
+/**
+ *  \brief Placement of the calling process according to the placement policy.
+ *
+ *  Service roles, then the extra receptionists, waiters and chefs, take the first cpus (one each, if there are enough),
+ *  groups take the remaining ones, round robin (PLACE_SPREAD) or all on the same cpu (PLACE_PACK), and helpers
+ *  are spread over them. With PLACE_SINGLE every process shares the first cpu. The affinity is inherited through exec. Failures are reported but not fatal.
+ *
+ *  \param placement placement policy
+ *  \param entity id of the entity the process will run
+ */
+static void placeProcess (int placement, unsigned int entity)
+{
+    cpu_set_t set;
+    int base, cpu;
+
+    if ((placement == PLACE_NONE) || (nCpus == 0)) {
+        return;
+    }
+    base = (nCpus > nServices) ? nServices : 0;                                         /* first cpu for groups */
+    if (placement == PLACE_SINGLE) cpu = cpuList[0];
+    else if (entity < GROUP_ID) cpu = cpuList[entity % (unsigned int) nCpus];
+    else if (entity >= HELPERS_ID) cpu = cpuList[base + (int) (entity - HELPERS_ID) % (nCpus - base)];
+    else if (entity >= CHEFS_ID)
+        cpu = cpuList[(nRoles + nExtraReceptionists + nExtraWaiters + (int) (entity - CHEFS_ID)) % nCpus];
+    else if (entity >= WAITERS_ID)
+        cpu = cpuList[(nRoles + nExtraReceptionists + (int) (entity - WAITERS_ID)) % nCpus];
+    else if (entity >= RECEPTIONISTS_ID) cpu = cpuList[(nRoles + (int) (entity - RECEPTIONISTS_ID)) % nCpus];
+    else if (placement == PLACE_PACK) cpu = cpuList[base];
+    else cpu = cpuList[base + (int) (entity - GROUP_ID) % (nCpus - base)];
+
+    CPU_ZERO (&set);
+    CPU_SET (cpu, &set);
+    if (sched_setaffinity (0, sizeof (set), &set) == -1) {
+        perror ("error on setting the cpu affinity");
+    }
+}
+
+/**
+ *  \brief Closing of the restaurant, once all groups have left.
+ *
+ *  No request can be pending by then, so the receptionists, the waiters, the chefs and every kitchen station are just
+ *  woken up through their usual channel: finding the closing flag set and nothing queued, they terminate.
+ *
+ *  \param sh pointer to the shared memory region
+ *  \param semgid semaphore set access identifier
+ */
+static void closeService (SHARED_DATA *sh, int semgid)
+{
+    int s, k;
+
+    __atomic_store_n (&sh->closing, true, __ATOMIC_SEQ_CST);
+    if (sh->fSt.waiterEvents) {
+        if (rqNotify (sh->shutdownEvent) == -1) {
+            perror ("error on the notification of the waiter");
+            exit (EXIT_FAILURE);
+        }
+    }
+    else {
+        for (k = 0; k < (int) sh->fSt.nWaiters; k++) {
+            if (semUp (semgid, sh->waiterRequest[k]) == -1) {
+                perror ("error on the up operation for semaphore access");
+                exit (EXIT_FAILURE);
+            }
+        }
+    }
+    for (k = 0; k < (int) sh->fSt.nDishes; k++) {
+        if (semUp (semgid, sh->waitOrder[k]) == -1) {
+            perror ("error on the up operation for semaphore access");
+            exit (EXIT_FAILURE);
+        }
+    }
+    for (k = 0; k < (int) sh->fSt.nReceptionists; k++) {
+        if (semUp (semgid, sh->receptionistReq) == -1) {
+            perror ("error on the up operation for semaphore access");
+            exit (EXIT_FAILURE);
+        }
+    }
+    for (s = STATION_PREP+1; sh->fSt.pipeline && (s < NUMSTATIONS); s++) {
+        if (semUp (semgid, sh->stationItems[s]) == -1) {
+            perror ("error on the up operation for semaphore access");
+            exit (EXIT_FAILURE);
+        }
+    }
+}
+
+/**
+ *  \brief Spawning of a helper, a waiter or chef that shares the channel of a zone or dish.
+ *
+ *  The helper takes the next helper entity id; it wakes up every sampling period to leave once it is retired.
+ *
+ *  \param sh pointer to the shared memory region
+ *  \param role role of the helper (WAITER_ID or CHEF_ID)
+ *  \param k zone (waiters) or dish (chefs) the helper works for
+ *  \param nFic name of the logging file
+ *  \param key access key to shared memory and semaphore set, as passed to the entities
+ */
+static void spawnHelper (SHARED_DATA *sh, unsigned int role, int k, char nFic[], char key[])
+{
+    char nFicErr[] = "error_        ";                                                     /* base name of error files */
+    char num[3][12];                                                     /* numeric value conversion (up to 10 digits) */
+    unsigned int h = sh->fSt.nHelpers;
+    int pid;
+
+    entityName (HELPERS_ID + h, nFicErr + 6);
+    sprintf (num[0], "%d", k);
+    sprintf (num[1], "%d", STATION_ALL);
+    sprintf (num[2], "%u", h);
+    __atomic_store_n (&sh->retire[h], false, __ATOMIC_SEQ_CST);
+    if ((pid = fork ()) < 0) {
+        perror ("error on the fork operation for a helper");
+        exit (EXIT_FAILURE);
+    }
+    if (pid == 0) {
+        placeProcess (sh->fSt.placement, HELPERS_ID + h);
+        if (role == WAITER_ID) {
+            execl (WAITER, WAITER, nFic, key, nFicErr, num[0], num[2], NULL);
+        }
+        else execl (CHEF, CHEF, nFic, key, nFicErr, num[1], num[0], num[2], NULL);
+        perror ("error on the generation of a helper process");
+        exit (EXIT_FAILURE);
+    }
+    helperPid[h] = pid;
+    helperRole[h] = role;
+    helperOf[h] = k;
+    helperWorking[h] = true;
+    if (++nWorking > peakWorking) peakWorking = nWorking;
+    sh->fSt.nHelpers = h + 1;
+}
+
+/**
+ *  \brief Elastic staffing of the zones and dishes, from a sample of the requests queued to them.
+ *
+ *  The requests queued to a zone are the wakeups pending for its waiter and the groups waiting to issue a
+ *  request; those queued to a dish are the orders waiting for its chef. A zone or dish with elasticUp requests
+ *  or more, or whose oldest one (food ready or order) has waited elasticAge or longer, gets one more helper, up
+ *  to maxHelpers; one with elasticDown requests or fewer has its newest helper retired. Zones are only staffed
+ *  with the semaphore front end and dishes without the pipeline.
+ *
+ *  \param sh pointer to the shared memory region
+ *  \param semgid semaphore set access identifier
+ *  \param nFic name of the logging file
+ *  \param key access key to shared memory and semaphore set, as passed to the entities
+ */
+static void scaleStaff (SHARED_DATA *sh, int semgid, char nFic[], char key[])
+{
+    int depth[MAXWAITERS+MAXDISHES];                          /* requests queued to each zone, then to each dish */
+    unsigned long long age[MAXWAITERS+MAXDISHES],                 /* time waited by the oldest request of each */
+                       now;
+    REQQUEUE *q;
+    int k, h, n, newest, target;
+    unsigned int role;
+
+    for (k = 0; k < MAXWAITERS+MAXDISHES; k++) {
+        depth[k] = -1;                                                                        /* not staffed */
+        age[k] = 0;
+    }
+    if (semDown (semgid, sh->mutex) == -1) {
+        perror ("error on the down operation for semaphore access");
+        exit (EXIT_FAILURE);
+    }
+    now = nowUSec ();
+    for (k = 0; !sh->fSt.waiterEvents && (k < (int) sh->fSt.nWaiters); k++) {
+        q = &sh->fSt.foodReadyQueue[k];
+        depth[k] = semGetValue (semgid, sh->waiterRequest[k]) + semGetWaiting (semgid, sh->waiterRequestPossible[k]);
+        if (q->count > 0) age[k] = now - sh->cookedAt[q->item[q->head].reqGroup];
+    }
+    for (k = 0; !sh->fSt.pipeline && (k < (int) sh->fSt.nDishes); k++) {
+        q = &sh->fSt.orderQueue[k];
+        depth[MAXWAITERS+k] = q->count;
+        if (q->count > 0) age[MAXWAITERS+k] = now - sh->orderedAt[q->item[q->head].reqGroup];
+    }
+    if (semUp (semgid, sh->mutex) == -1) {
+        perror ("error on the up operation for semaphore access");
+        exit (EXIT_FAILURE);
+    }
+
+    for (k = 0; k < MAXWAITERS+MAXDISHES; k++) {
+        if (depth[k] < 0) {
+            continue;
+        }
+        role = (k < MAXWAITERS) ? WAITER_ID : CHEF_ID;
+        target = (k < MAXWAITERS) ? k : k - MAXWAITERS;
+        for (n = 0, newest = -1, h = 0; h < (int) sh->fSt.nHelpers; h++) {
+            if (helperWorking[h] && (helperRole[h] == role) && (helperOf[h] == target)) {
+                n += 1;
+                newest = h;
+            }
+        }
+        if ((depth[k] >= sh->fSt.elasticUp) || ((sh->fSt.elasticAge > 0) && (age[k] >= sh->fSt.elasticAge))) {
+            if ((n < (int) sh->fSt.maxHelpers) && (sh->fSt.nHelpers < MAXHELPERS)) {
+                spawnHelper (sh, role, target, nFic, key);
+            }
+        }
+        else if ((depth[k] <= sh->fSt.elasticDown) && (newest >= 0)) {
+            __atomic_store_n (&sh->retire[newest], true, __ATOMIC_SEQ_CST);
+            helperWorking[newest] = false;
+            nWorking -= 1;
+            nRetired += 1;
+        }
+    }
+}
+
 /**
  *  \brief Main program.
  *
@@ -54,17 +722,37 @@ int main (int argc, char *argv[])
     char nFicErr[] = "error_        ";                                                     /* base name of error files */
     int shmid,                                                                      /* shared memory access identifier */
         semgid;                                                                     /* semaphore set access identifier */
-    unsigned int  m;                                                                             /* counting variables */
+    unsigned int  m,                                                                             /* counting variables */
+                  nGone;                                                                /* number of groups reaped */
     SHARED_DATA *sh;                                                                /* pointer to shared memory region */
-    int pidCH,                                                                             /* pilot process identifier */
-        pidWT,                                                                     /* hostess process identifier array */
-        pidRT,                                                                     /* hostess process identifier array */
+    int pidCH[MAXDISHES],                                                        /* chef processes identifier array */
+        pidWT[MAXWAITERS],                                                    /* waiter processes identifier array */
+        pidRT[MAXRECEPTIONISTS],                                        /* receptionist processes identifier array */
         pidGR[MAXGROUPS];                                                     /* passengers processes identifier array */
     int key;                                                           /*access key to shared memory and semaphore set */
     char num[2][12];                                                     /* numeric value conversion (up to 10 digits) */
+    char name[8];                                                                                   /* entity name */
+    char dish[12];                                                                   /* dish cooked by a chef */
+    FULL_STAT config;                                                                 /* settings of the config file */
+    bool stalled;                                                               /* stall reported by the watchdog */
+    struct rusage ru,                                                          /* resource usage of a terminated child */
+                  usage[NROLES];                                                          /* resource usage per role */
+    unsigned int nUsage[NROLES];                                                /* number of entities accounted per role */
+    unsigned long semOps[NROLES],                                             /* semaphore operations issued per role */
+                  spinHits[NROLES],                                         /* downs satisfied while spinning per role */
+                  spinMisses[NROLES];                                          /* downs that had to block per role */
+    long long perfCount[NROLES][NUMPERFCOUNTERS];                                   /* performance counters per role */
+    UTILIZATION rtUtil[MAXRECEPTIONISTS];                                     /* busy/idle accounting per receptionist */
+    UTILIZATION wtUtil[MAXWAITERS];                                                /* busy/idle accounting per waiter */
+    UTILIZATION chUtil[MAXDISHES];                                                   /* busy/idle accounting per chef */
+    int c;
+    unsigned int r;
     int status,                                                                                    /* execution status */
         info;                                                                                               /* info id */
-    int g, t;
+    int g, t, s, k;
+    int pidST[NUMSTATIONS],                          /* prep and plate station processes identifier array */
+        pid;
+    unsigned int id;                                                                       /* entity id of a station */
 
     /* getting log file name */
     if(argc==2) {
@@ -79,6 +767,41 @@ int main (int argc, char *argv[])
     }
     sprintf (num[1], "%d", key);
 
+    /* reading the config file, before touching the shared region so that it can be placed */
+    memset (&config, 0, sizeof (config));
+    config.watchdogTimeout = WATCHDOGTIME;
+    config.watchdogAbort = false;
+    config.perfCounters = false;
+    config.placement = PLACE_NONE;
+    config.batchSize = 1;
+    config.tripSize = 1;
+    config.courses = 1;
+    config.nReceptionists = 1;
+    config.nWaiters = 1;
+    config.nDishes = 1;
+    config.maxHelpers = 1;
+    for (t = 0; t < MAXTABLES; t++) {
+        config.tableZone[t] = -1;                                                      /* zone not given */
+    }
+    for (g = 0; g < MAXGROUPS; g++) {
+        config.resvFrom[g] = -1;                                                         /* groups walk in */
+        config.firstDish[g] = -1;                                                   /* first dish not given */
+    }
+    for (k = 0; k < MAXDISHES; k++) {
+        config.dishCook[k] = 100;
+    }
+    config.nTables = DEFTABLES;
+    for (t = 0; t < DEFTABLES; t++) {
+        config.tableSeats[t] = DEFSEATS;
+    }
+    config.burners = 1;
+    config.stationQueueSize = 2;
+    readConfig (&config);
+    nExtraReceptionists = (int) config.nReceptionists - 1;
+    nExtraWaiters = (int) config.nWaiters - 1;
+    nRoles = config.pipeline ? GROUP_ID : PREP_ID;
+    nServices = nRoles + nExtraReceptionists + nExtraWaiters + (int) config.nDishes - 1;
+
     /* creating and initializing the shared memory region and the log file */
     if ((shmid = shmemCreate (key, sizeof (SHARED_DATA))) == -1) { 
         perror ("error on creating the shared memory region");
@@ -89,6 +812,20 @@ int main (int argc, char *argv[])
         exit (EXIT_FAILURE);
     }
 
+    /* the pages of the shared region are allocated on the NUMA node of the cpu that first touches them:
+       the generator initializes it from the receptionist's cpu, next to the service roles */
+    CPU_ZERO (&runCpus);
+    sched_getaffinity (0, sizeof (runCpus), &runCpus);
+    for (nCpus = 0, c = 0; c < CPU_SETSIZE; c++) {
+        if (CPU_ISSET (c, &runCpus)) {
+            cpuList[nCpus++] = c;
+        }
+    }
+    placeProcess (config.placement, RECEPTIONIST_ID);
+    memset (sh, 0, sizeof (SHARED_DATA));
+    sh->fSt = config;
+    sched_setaffinity (0, sizeof (runCpus), &runCpus);
+
     /* initialize random generator */
     srandom ((unsigned int) getpid ());                                
 
@@ -101,19 +838,42 @@ int main (int argc, char *argv[])
         sh->fSt.assignedTable[g] = -1;                                     /* groups are initialized */
     }
     sh->fSt.groupsWaiting=0;
-
-    FILE *fp = fopen("config.txt","r");
-    if(fp==NULL) {
-        perror("Could not open config file");
-        exit(EXIT_FAILURE);
+    for (g = 0; g < NUMENTITIES; g++) {
+        sh->blockedOn[g] = 0;                                                /* nobody is blocked yet */
     }
-
-    /* parse config file */
-    fscanf(fp,"%*[^\n]");
-    fscanf(fp,"%d ",&sh->fSt.nGroups);
-    fscanf(fp,"%*[^\n]");
-    for(g=0;g < sh->fSt.nGroups;g++) {
-       fscanf(fp,"%d %d", &sh->fSt.startTime[g], &sh->fSt.eatTime[g]);
+    sh->stalled = 0;
+    sh->shutdownEvent = -1;
+    for (k = 0; k < MAXWAITERS; k++) {
+        sh->foodReqEvent[k] = sh->foodReadyEvent[k] = -1;
+    }
+    if (sh->fSt.waiterEvents) {                 /* inherited by every entity, through fork and exec */
+        if ((sh->shutdownEvent = eventfd (0, EFD_NONBLOCK)) == -1) {
+            perror ("error on creating the eventfds of the waiter");
+            exit (EXIT_FAILURE);
+        }
+        for (k = 0; k < (int) sh->fSt.nWaiters; k++) {
+            if (((sh->foodReqEvent[k] = eventfd (0, EFD_NONBLOCK)) == -1) ||
+                ((sh->foodReadyEvent[k] = eventfd (0, EFD_NONBLOCK)) == -1)) {
+                perror ("error on creating the eventfds of the waiter");
+                exit (EXIT_FAILURE);
+            }
+        }
+    }
+    for (k = 0; k < MAXDISHES; k++) {
+        rqInit (&sh->fSt.orderQueue[k]);
+    }
+    for (s = 0; s < NUMSTATIONS; s++) {
+        rqInit (&sh->fSt.stationQueue[s]);
+    }
+    for (k = 0; k < MAXWAITERS; k++) {
+        rqInit (&sh->fSt.foodReqQueue[k]);
+        rqInit (&sh->fSt.foodReadyQueue[k]);
+    }
+    for (g = 0; g < NUMENTITIES; g++) {
+        sh->semOps[g] = 0;
+        for (c = 0; c < NUMPERFCOUNTERS; c++) {
+            sh->perfCount[g][c] = -1;                                          /* counters not available yet */
+        }
     }
    
     /* create log file */
@@ -124,37 +884,61 @@ int main (int argc, char *argv[])
     sh->mutex                       = MUTEX;                                /* mutual exclusion semaphore id */
     sh->receptionistReq             = RECEPTIONISTREQ;                                                      
     sh->receptionistRequestPossible = RECEPTIONISTREQUESTPOSSIBLE;                                                      
-    sh->waiterRequest               = WAITERREQUEST;                                                      
-    sh->waiterRequestPossible       = WAITERREQUESTPOSSIBLE;                                                      
-    sh->waitOrder                   = WAITORDER;                                                      
-    sh->orderReceived               = ORDERRECEIVED;                                                      
+    sh->waiterRequest[0]            = WAITERREQUEST;
+    sh->waiterRequestPossible[0]    = WAITERREQUESTPOSSIBLE;
+    for(k=1;k<(int)sh->fSt.nWaiters;k++) {
+       sh->waiterRequest[k]         = ZONEREQUEST+k-1;
+       sh->waiterRequestPossible[k] = ZONEREQUESTPOSSIBLE+k-1;
+    }
+    sh->waitOrder[0]                = WAITORDER;
+    for(k=1;k<(int)sh->fSt.nDishes;k++) {
+       sh->waitOrder[k]             = DISHORDER+k-1;
+    }
     for(g=0;g<sh->fSt.nGroups;g++) {
        sh->waitForTable[g]          = WAITFORTABLE+g;                                                      
     }
-    for(t=0;t<NUMTABLES;t++) {
+    for(t=0;t<sh->fSt.nTables;t++) {
        sh->foodArrived[t]           = FOODARRIVED+t;                                                      
        sh->tableDone[t]             = TABLEDONE+t;                                                      
        sh->requestReceived[t]       = REQUESTRECEIVED+t;                              
     }
+    for(s=1;s<NUMSTATIONS;s++) {
+       sh->stationItems[s]          = STATIONITEMS+s;
+       sh->stationSlots[s]          = STATIONSLOTS+s;
+    }
 
     /* creating and initializing the semaphore set */
     if ((semgid = semCreate (key, SEM_NU)) == -1) { 
         perror ("error on creating the semaphore set");
         exit (EXIT_FAILURE);
     }
+    if (sh->fSt.spinMax > 0) {                                       /* the shadow must see the initial ups */
+        semSpinEnable (sh->semShadow, sh->fSt.spinMax);
+    }
     if (semUp (semgid, sh->mutex) == -1) {                   /* enabling access to critical region */
         perror ("error on executing the up operation for semaphore access");
         exit (EXIT_FAILURE);
     }
-    if (semUp (semgid, sh->waiterRequestPossible) == -1) {                   /* enabling access to critical region */
-        perror ("error on executing the up operation for semaphore access");
-        exit (EXIT_FAILURE);
+    for (k = 0; k < (int) sh->fSt.nWaiters; k++) {
+        if (semUp (semgid, sh->waiterRequestPossible[k]) == -1) {               /* enabling access to critical region */
+            perror ("error on executing the up operation for semaphore access");
+            exit (EXIT_FAILURE);
+        }
     }
     if (semUp (semgid, sh->receptionistRequestPossible) == -1) {                   /* enabling access to critical region */
         perror ("error on executing the up operation for semaphore access");
         exit (EXIT_FAILURE);
     }
 
+    for (s = 1; s < NUMSTATIONS; s++) {                             /* room in the queues between stations */
+        for (c = 0; c < (int) sh->fSt.stationQueueSize; c++) {
+            if (semUp (semgid, sh->stationSlots[s]) == -1) {
+                perror ("error on executing the up operation for semaphore access");
+                exit (EXIT_FAILURE);
+            }
+        }
+    }
+
     /* generation of intervening entities processes */                            
     /* group processes */
     strcpy (nFicErr + 6, "GR");
@@ -165,64 +949,244 @@ int main (int argc, char *argv[])
         }
         sprintf(num[0],"%d",g);
         sprintf(nFicErr+8,"%02d",g); 
-        if (pidGR[g] == 0)
+        if (pidGR[g] == 0) {
+            placeProcess (sh->fSt.placement, GROUP_ID + (unsigned int) g);
             if (execl (GROUP, GROUP, num[0], nFic, num[1], nFicErr, NULL) < 0) { 
                 perror ("error on the generation of the group process");
                 exit (EXIT_FAILURE);
             }
+        }
     }
-    /* waiter process */
-    strcpy (nFicErr + 6, "WT");
-    if ((pidWT = fork ()) < 0)  {                            
-        perror ("error on the fork operation for the waiter");
-        exit (EXIT_FAILURE);
-    }
-    if (pidWT == 0) {
-        if (execl (WAITER, WAITER, nFic, num[1], nFicErr, NULL) < 0) {
-            perror ("error on the generation of the waiter process");
+    /* waiter processes (one per zone) */
+    for (k = 0; k < (int) sh->fSt.nWaiters; k++) {
+        id = (k == 0) ? WAITER_ID : WAITERS_ID + (unsigned int) (k - 1);
+        entityName (id, nFicErr + 6);
+        sprintf (num[0], "%d", k);
+        if ((pidWT[k] = fork ()) < 0)  {
+            perror ("error on the fork operation for the waiter");
             exit (EXIT_FAILURE);
         }
+        if (pidWT[k] == 0) {
+            placeProcess (sh->fSt.placement, id);
+            if (execl (WAITER, WAITER, nFic, num[1], nFicErr, num[0], "-1", NULL) < 0) {
+                perror ("error on the generation of the waiter process");
+                exit (EXIT_FAILURE);
+            }
+        }
     }
-    /* chef process */
-    strcpy (nFicErr + 6, "CH");
-    if ((pidCH = fork ()) < 0) {               
-        perror ("error on the fork operation for the chef");
-        exit (EXIT_FAILURE);
+    /* chef processes (one per dish, or one per station if the kitchen is a pipeline) */
+    for (s = 0; s < NUMSTATIONS; s++) {
+        pidST[s] = -1;
+    }
+    for (k = 0; k < MAXDISHES; k++) {
+        pidCH[k] = -1;
     }
-    if (pidCH == 0)
-        if (execl (CHEF, CHEF, nFic, num[1], nFicErr, NULL) < 0) { 
-            perror ("error on the generation of the chef process");
+    for (c = 0; c < (sh->fSt.pipeline ? NUMSTATIONS : (int) sh->fSt.nDishes); c++) {
+        s = sh->fSt.pipeline ? c : STATION_ALL;
+        k = sh->fSt.pipeline ? 0 : c;                                                         /* dish cooked */
+        id = (s != STATION_ALL) ? stationId[s] : (k == 0) ? CHEF_ID : CHEFS_ID + (unsigned int) (k - 1);
+        entityName (id, nFicErr + 6);
+        sprintf (num[0], "%d", s);
+        sprintf (dish, "%d", k);
+        if ((pid = fork ()) < 0) {               
+            perror ("error on the fork operation for the chef");
             exit (EXIT_FAILURE);
         }
-
-    /* receptionist process */
-    strcpy (nFicErr + 6, "RT");
-    if ((pidRT = fork ()) < 0) {               
-        perror ("error on the fork operation for the chef");
-        exit (EXIT_FAILURE);
+        if (pid == 0) {
+            placeProcess (sh->fSt.placement, id);
+            if (execl (CHEF, CHEF, nFic, num[1], nFicErr, num[0], dish, "-1", NULL) < 0) { 
+                perror ("error on the generation of the chef process");
+                exit (EXIT_FAILURE);
+            }
+        }
+        if (s == STATION_ALL) pidCH[k] = pid;
+        else pidST[s] = pid;
     }
-    if (pidRT == 0)
-        if (execl (RECEPTIONIST, RECEPTIONIST, nFic, num[1], nFicErr, NULL) < 0) { 
-            perror ("error on the generation of the receptionist process");
+
+    /* receptionist processes */
+    for (k = 0; k < (int) sh->fSt.nReceptionists; k++) {
+        id = (k == 0) ? RECEPTIONIST_ID : RECEPTIONISTS_ID + (unsigned int) (k - 1);
+        entityName (id, nFicErr + 6);
+        sprintf (num[0], "%d", k);
+        if ((pidRT[k] = fork ()) < 0) {
+            perror ("error on the fork operation for the receptionist");
             exit (EXIT_FAILURE);
         }
+        if (pidRT[k] == 0) {
+            placeProcess (sh->fSt.placement, id);
+            if (execl (RECEPTIONIST, RECEPTIONIST, nFic, num[1], nFicErr, num[0], NULL) < 0) {
+                perror ("error on the generation of the receptionist process");
+                exit (EXIT_FAILURE);
+            }
+        }
+    }
+
+    /* start of the queueing averages */
+    avgStart (&sh->waitingAvg, 0);
+    avgStart (&sh->occupancyAvg, 0);
+    avgStart (&sh->seatsAvg, 0);
+    for (s = 0; s < NUMSTATIONS; s++) {
+        avgStart (&sh->stationQueueAvg[s], 0);
+    }
+    for (k = 0; k < (int) sh->fSt.nDishes; k++) {
+        avgStart (&sh->orderQueueAvg[k], 0);
+    }
 
     /* signaling start of operations */
+    sh->openedAt = nowUSec ();
     if (semSignal (semgid) == -1) {
         perror ("error on signaling start of operations");
         exit (EXIT_FAILURE);
     }
 
     /* waiting for the termination of the intervening entities processes */
-    m = 0;
+    memset (usage, 0, sizeof (usage));
+    memset (nUsage, 0, sizeof (nUsage));
+    m = nGone = 0;
     do {
-        info = wait (&status);
+        info = wait4 (-1, &status, (sh->fSt.elasticPeriod > 0) ? WNOHANG : 0, &ru);
         if (info == -1) { 
             perror ("error on aiting for an intervening process");
             exit (EXIT_FAILURE);
         }
+        if (info == 0) {                              /* nobody terminated yet: time to sample the queues */
+            if (!sh->closing) {
+                scaleStaff (sh, semgid, nFic, num[1]);
+            }
+            usleep (sh->fSt.elasticPeriod);
+            continue;
+        }
+        for (r = GROUP_ID, k = 0; k < (int) sh->fSt.nDishes; k++) {
+            if (info == pidCH[k]) r = CHEF_ID;
+        }
+        for (s = 0; s < NUMSTATIONS; s++) {
+            if (info == pidST[s]) r = stationId[s];
+        }
+        for (k = 0; k < (int) sh->fSt.nReceptionists; k++) {
+            if (info == pidRT[k]) r = RECEPTIONIST_ID;
+        }
+        for (k = 0; k < (int) sh->fSt.nWaiters; k++) {
+            if (info == pidWT[k]) r = WAITER_ID;
+        }
+        for (k = 0; k < (int) sh->fSt.nHelpers; k++) {
+            if (info == helperPid[k]) r = helperRole[k];
+        }
+        if ((r == GROUP_ID) && (++nGone == (unsigned int) sh->fSt.nGroups)) {
+            closeService (sh, semgid);                             /* no more requests: service may leave */
+        }
+        addUsage (&usage[r], &ru);
+        nUsage[r] += 1;
         m += 1;
-    } while (m < 3+sh->fSt.nGroups);
+    } while (m < (sh->fSt.pipeline ? NUMSTATIONS : sh->fSt.nDishes)+sh->fSt.nReceptionists+sh->fSt.nWaiters+
+                 sh->fSt.nHelpers+(unsigned int)sh->fSt.nGroups);
+
+    /* run summary */
+    for (r = 0; r < NROLES; r++) {
+        semOps[r] = spinHits[r] = spinMisses[r] = 0;
+    }
+    for (g = 0; g < NUMENTITIES; g++) {
+        r = roleOf ((unsigned int) g);
+        semOps[r] += sh->semOps[g];
+        spinHits[r] += sh->spinHits[g];
+        spinMisses[r] += sh->spinMisses[g];
+    }
+    printUsage (stdout, NROLES, roleName, nUsage, usage, semOps);
+    for (k = 0; k < (int) sh->fSt.nReceptionists; k++) {                  /* receptionists, before they are summed up */
+        rtUtil[k] = sh->util[(k == 0) ? RECEPTIONIST_ID : RECEPTIONISTS_ID + k - 1];
+    }
+    for (k = 1; k < (int) sh->fSt.nReceptionists; k++) {
+        sh->util[RECEPTIONIST_ID].busyTime += rtUtil[k].busyTime;
+        sh->util[RECEPTIONIST_ID].idleTime += rtUtil[k].idleTime;
+    }
+    for (k = 0; k < (int) sh->fSt.nWaiters; k++) {                               /* waiters, likewise */
+        wtUtil[k] = sh->util[(k == 0) ? WAITER_ID : WAITERS_ID + k - 1];
+    }
+    for (k = 1; k < (int) sh->fSt.nWaiters; k++) {
+        sh->util[WAITER_ID].busyTime += wtUtil[k].busyTime;
+        sh->util[WAITER_ID].idleTime += wtUtil[k].idleTime;
+    }
+    for (k = 0; k < (int) sh->fSt.nDishes; k++) {                                 /* chefs, likewise */
+        chUtil[k] = sh->util[(k == 0) ? CHEF_ID : CHEFS_ID + k - 1];
+    }
+    for (k = 1; k < (int) sh->fSt.nDishes; k++) {
+        sh->util[CHEF_ID].busyTime += chUtil[k].busyTime;
+        sh->util[CHEF_ID].idleTime += chUtil[k].idleTime;
+    }
+    for (k = 0; k < (int) sh->fSt.nHelpers; k++) {                         /* helpers, into the role they work in */
+        sh->util[helperRole[k]].busyTime += sh->util[HELPERS_ID + k].busyTime;
+        sh->util[helperRole[k]].idleTime += sh->util[HELPERS_ID + k].idleTime;
+    }
+    printUtilization (stdout, GROUP_ID, roleName, sh->util, avgMean (&sh->waitingAvg, nowUSec ()),
+                      avgMean (&sh->occupancyAvg, nowUSec ()), (unsigned int) sh->fSt.nTables);
+    printLatencies (stdout, NUMLATENCIES, latencyName, sh->latency);
+    printReception (stdout, sh->fSt.nReceptionists, sh->receptions, rtUtil, &sh->latency[LAT_CHECKIN],
+                    &sh->latency[LAT_CHECKOUT], &sh->releaseLag);
+    printSeating (stdout, sh->fSt.nTables, sh->fSt.tableSeats, sh->fSt.nGroups, sh->fSt.groupSize,
+                  avgMean (&sh->seatsAvg, nowUSec ()), sh->sizeWait, sh->combined);
+    for (g = 0; (g < sh->fSt.nGroups) && (sh->fSt.resvFrom[g] < 0); g++);
+    if (g < sh->fSt.nGroups) {
+        printReservations (stdout, sh->bookingWait, sh->honored, sh->dropped, sh->heldIdle);
+    }
+    for (g = 0; (g < sh->fSt.nGroups) && (sh->fSt.tolerance[g] < 0) && (sh->fSt.patience[g] == 0); g++);
+    if (g < sh->fSt.nGroups) {
+        printAdmission (stdout, sh->fSt.nGroups, sh->balked, &sh->renegeWait);
+    }
+    printKitchen (stdout, (unsigned long) sh->fSt.nGroups * sh->fSt.courses, sh->batches, sh->cookTime,
+                  chUtil[0].busyTime + chUtil[0].idleTime);
+    if (sh->fSt.nDishes > 1) {
+        printDishes (stdout, sh->fSt.nDishes, chUtil, sh->orderQueueAvg, sh->dishLatency);
+    }
+    if (sh->fSt.pipeline) {
+        printPipeline (stdout, NUMSTATIONS, stationName, stationId, sh->util, sh->stationQueueAvg,
+                       sh->stationBlocked, sh->stationBlockedTime);
+    }
+    if (sh->fSt.elasticPeriod > 0) {
+        printStaffing (stdout, sh->fSt.nHelpers, helperRole, &sh->util[HELPERS_ID], nRetired, peakWorking);
+    }
+    printTrips (stdout, sh->tripRequests, sh->trips);
+    if (sh->fSt.nWaiters > 1) {
+        printZones (stdout, sh->fSt.nWaiters, sh->fSt.nTables, sh->fSt.tableZone, sh->zoneRequests, sh->zoneTrips,
+                    sh->zoneSteals, sh->zoneStolen, wtUtil);
+    }
+    if (sh->fSt.spinMax > 0) {
+        printSpin (stdout, NROLES, roleName, spinHits, spinMisses);
+    }
+    if (sh->fSt.perfCounters) {
+        for (r = 0; r < NROLES; r++) {
+            for (c = 0; c < NUMPERFCOUNTERS; c++) {
+                perfCount[r][c] = 0;
+            }
+        }
+        for (g = 0; g < NUMENTITIES; g++) {
+            if (!entityInRun (&sh->fSt, (unsigned int) g)) {
+                continue;                                                             /* entity not in this run */
+            }
+            r = roleOf ((unsigned int) g);
+            for (c = 0; c < NUMPERFCOUNTERS; c++) {
+                if ((sh->perfCount[g][c] < 0) || (perfCount[r][c] < 0))
+                    perfCount[r][c] = -1;                                  /* missing for some entity of the role */
+                else perfCount[r][c] += sh->perfCount[g][c];
+            }
+        }
+        printPerf (stdout, NROLES, roleName, perfCount);
+    }
+
+    /* reporting a stall detected by the watchdog */
+    stalled = (sh->stalled != 0);
+    if (stalled) {
+        entityName ((unsigned int) sh->stalled - 1, name);
+        fprintf (stderr, "%s by the watchdog: stall first detected by %s (state dumped on its stderr)\n",
+                 sh->fSt.watchdogAbort ? "Run aborted" : "Stall reported", name);
+    }
+
+    /* closing the eventfds of the waiter */
+    if (sh->fSt.waiterEvents) {
+        for (k = 0; k < (int) sh->fSt.nWaiters; k++) {
+            close (sh->foodReqEvent[k]);
+            close (sh->foodReadyEvent[k]);
+        }
+        close (sh->shutdownEvent);
+    }
 
     /* destruction of semaphore set and shared region */
     if (semDestroy (semgid) == -1) {
@@ -238,5 +1202,5 @@ int main (int argc, char *argv[])
         exit (EXIT_FAILURE);
     }
 
-    return EXIT_SUCCESS;
+    return (stalled && config.watchdogAbort) ? EXIT_FAILURE : EXIT_SUCCESS;
 }
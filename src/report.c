@@ -0,0 +1,523 @@
+/**
+ *  \file report.c (implementation file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  \brief Printing the run summary.
+ *
+ *  Defined operations:
+ *     \li accumulation of the resource usage of an entity into its role
+ *     \li printing the resource usage per role
+ *     \li printing the performance counters per role
+ *     \li printing the utilization of the service roles and the queueing averages
+ *     \li printing latency distributions
+ *     \li printing the outcome of spin-then-block waits per role
+ *     \li printing the batching outcome and throughput of the kitchen
+ *     \li printing the outcome of the kitchen pipeline
+ *     \li printing the trips made by the waiter
+ *     \li printing the seating outcome per size class
+ *     \li printing the outcome of the reservations
+ *     \li printing the outcome of admission control
+ *     \li printing the throughput and latency of the reception
+ *     \li printing the work of the waiter of each zone
+ *     \li printing the work of the chef of each dish
+ *     \li printing the outcome of elastic staffing.
+ */
+
+#include <stdio.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "metrics.h"
+#include "report.h"
+
+/* internal functions */
+
+static double msecs(struct timeval *tv)
+{
+    return tv->tv_sec * 1000.0 + tv->tv_usec / 1000.0;
+}
+
+static void printCount(FILE *fic, long long count)
+{
+    if (count < 0) {
+        fprintf(fic, " %14s", "n/a");
+    }
+    else fprintf(fic, " %14lld", count);
+}
+
+/* external functions */
+
+/**
+ *  \brief Accumulation of the resource usage of an entity into its role.
+ *
+ *  CPU times, page faults and context switches are added up; the maximum resident set size is the
+ *  largest one among the entities of the role.
+ *
+ *  \param acc resource usage of the role
+ *  \param ru resource usage of the entity
+ */
+void addUsage (struct rusage *acc, struct rusage *ru)
+{
+    timeradd(&acc->ru_utime, &ru->ru_utime, &acc->ru_utime);
+    timeradd(&acc->ru_stime, &ru->ru_stime, &acc->ru_stime);
+    acc->ru_minflt += ru->ru_minflt;
+    acc->ru_majflt += ru->ru_majflt;
+    acc->ru_nvcsw  += ru->ru_nvcsw;
+    acc->ru_nivcsw += ru->ru_nivcsw;
+    if (ru->ru_maxrss > acc->ru_maxrss) {
+        acc->ru_maxrss = ru->ru_maxrss;
+    }
+}
+
+/**
+ *  \brief Printing the resource usage per role.
+ *
+ *  One line per role with user and system CPU time, voluntary and involuntary context switches,
+ *  minor page faults, maximum resident set size and semaphore operations. The kernel does not account
+ *  system calls per process, so semaphore operations, which are the bulk of them, stand in for that.
+ *  Roles without entities are left out.
+ *
+ *  \param fic open stream
+ *  \param nRoles number of roles
+ *  \param role name of each role
+ *  \param n number of entities accounted in each role
+ *  \param ru resource usage of each role
+ *  \param semOps number of semaphore operations of each role
+ */
+void printUsage (FILE *fic, unsigned int nRoles, char *role[], unsigned int n[], struct rusage ru[],
+                 unsigned long semOps[])
+{
+    unsigned int r;
+
+    fprintf(fic, "\nResource usage per role\n");
+    fprintf(fic, "%-6s %3s %10s %10s %8s %8s %8s %10s %8s\n",
+            "role", "n", "user(ms)", "sys(ms)", "vcsw", "ivcsw", "minflt", "maxrss(kB)", "semops");
+    for (r = 0; r < nRoles; r++) {
+        if (n[r] == 0) {
+            continue;                                                     /* role not present in this run */
+        }
+        fprintf(fic, "%-6s %3u %10.2f %10.2f %8ld %8ld %8ld %10ld %8lu\n",
+                role[r], n[r], msecs(&ru[r].ru_utime), msecs(&ru[r].ru_stime),
+                ru[r].ru_nvcsw, ru[r].ru_nivcsw, ru[r].ru_minflt, ru[r].ru_maxrss, semOps[r]);
+    }
+}
+
+/**
+ *  \brief Printing the performance counters per role.
+ *
+ *  One line per role with cycles, instructions, instructions per cycle, cache misses and branch misses.
+ *  Counters that were not available to every entity of the role are printed as n/a.
+ *
+ *  \param fic open stream
+ *  \param nRoles number of roles
+ *  \param role name of each role
+ *  \param count counter totals of each role (-1 if not available)
+ */
+void printPerf (FILE *fic, unsigned int nRoles, char *role[], long long count[][NUMPERFCOUNTERS])
+{
+    unsigned int r;
+    int c;
+
+    fprintf(fic, "\nPerformance counters per role (user space)\n");
+    fprintf(fic, "%-6s %14s %14s %6s %14s %14s\n", "role", "cycles", "instructions", "ipc", "cache-misses",
+            "branch-misses");
+    for (r = 0; r < nRoles; r++) {
+        fprintf(fic, "%-6s", role[r]);
+        printCount(fic, count[r][PERF_CYCLES]);
+        printCount(fic, count[r][PERF_INSTRUCTIONS]);
+        if ((count[r][PERF_CYCLES] > 0) && (count[r][PERF_INSTRUCTIONS] >= 0)) {
+            fprintf(fic, " %6.2f", (double) count[r][PERF_INSTRUCTIONS] / count[r][PERF_CYCLES]);
+        }
+        else fprintf(fic, " %6s", "n/a");
+        for (c = PERF_CACHEMISSES; c < NUMPERFCOUNTERS; c++) {
+            printCount(fic, count[r][c]);
+        }
+        fprintf(fic, "\n");
+    }
+}
+
+/**
+ *  \brief Printing the utilization of the service roles and the queueing averages.
+ *
+ *  The role with the highest utilization is the bottleneck of the configuration. Roles that were not
+ *  accounted (e.g. the pipeline stations, when there is no pipeline) are left out.
+ *
+ *  \param fic open stream
+ *  \param nRoles number of service roles
+ *  \param role name of each role
+ *  \param util busy/idle accounting of each role
+ *  \param waiting time-weighted average number of groups waiting for a table
+ *  \param occupancy time-weighted average number of occupied tables
+ *  \param nTables number of tables
+ */
+void printUtilization (FILE *fic, unsigned int nRoles, char *role[], UTILIZATION util[],
+                       double waiting, double occupancy, unsigned int nTables)
+{
+    unsigned int r;
+    unsigned long long total;
+
+    fprintf(fic, "\nUtilization per service role\n");
+    fprintf(fic, "%-6s %10s %10s %8s\n", "role", "busy(ms)", "idle(ms)", "util(%)");
+    for (r = 0; r < nRoles; r++) {
+        total = util[r].busyTime + util[r].idleTime;
+        if (total == 0) {
+            continue;                                                     /* role not present in this run */
+        }
+        fprintf(fic, "%-6s %10.2f %10.2f %8.1f\n", role[r], util[r].busyTime / 1000.0, util[r].idleTime / 1000.0,
+                (total > 0) ? 100.0 * util[r].busyTime / total : 0.0);
+    }
+    fprintf(fic, "groups waiting (time-weighted avg): %.2f\n", waiting);
+    fprintf(fic, "occupied tables (time-weighted avg): %.2f of %u (%.1f%%)\n", occupancy, nTables,
+            100.0 * occupancy / nTables);
+}
+
+/**
+ *  \brief Printing latency distributions.
+ *
+ *  One line per latency with number of samples, mean, median, 99th percentile and maximum (in microseconds).
+ *  Percentiles are upper bounds of histogram buckets (within 1/8 of the value).
+ *
+ *  \param fic open stream
+ *  \param n number of latencies
+ *  \param name name of each latency
+ *  \param lat latency distributions
+ */
+void printLatencies (FILE *fic, unsigned int n, char *name[], LATENCY lat[])
+{
+    unsigned int l;
+
+    fprintf(fic, "\nLatencies (us)\n");
+    fprintf(fic, "%-16s %5s %10s %10s %10s %10s\n", "latency", "n", "mean", "p50", "p99", "max");
+    for (l = 0; l < n; l++) {
+        fprintf(fic, "%-16s %5lu %10.1f %10llu %10llu %10llu\n", name[l], lat[l].count,
+                (lat[l].count > 0) ? (double) lat[l].sum / lat[l].count : 0.0,
+                latPercentile(&lat[l], 50.0), latPercentile(&lat[l], 99.0), lat[l].max);
+    }
+}
+
+/**
+ *  \brief Printing the outcome of spin-then-block waits per role.
+ *
+ *  \param fic open stream
+ *  \param nRoles number of roles
+ *  \param role name of each role
+ *  \param hits downs satisfied while spinning of each role
+ *  \param misses downs that had to block of each role
+ */
+void printSpin (FILE *fic, unsigned int nRoles, char *role[], unsigned long hits[], unsigned long misses[])
+{
+    unsigned int r;
+
+    fprintf(fic, "\nSpin-then-block waits per role\n");
+    fprintf(fic, "%-6s %8s %8s %8s\n", "role", "spun", "blocked", "spun(%)");
+    for (r = 0; r < nRoles; r++) {
+        fprintf(fic, "%-6s %8lu %8lu %8.1f\n", role[r], hits[r], misses[r],
+                (hits[r] + misses[r] > 0) ? 100.0 * hits[r] / (hits[r] + misses[r]) : 0.0);
+    }
+}
+
+/**
+ *  \brief Printing the batching outcome and throughput of the kitchen.
+ *
+ *  \param fic open stream
+ *  \param orders number of orders cooked
+ *  \param batches number of batches they were cooked in
+ *  \param cookTime time spent cooking, summed over the burners (in microseconds)
+ *  \param lifeTime lifetime of the chef (in microseconds)
+ */
+void printKitchen (FILE *fic, unsigned long orders, unsigned long batches, unsigned long long cookTime,
+                   unsigned long long lifeTime)
+{
+    fprintf(fic, "\nKitchen\n");
+    fprintf(fic, "%lu orders in %lu batches (%.2f per batch), %.1f us cooking per order\n", orders, batches,
+            (batches > 0) ? (double) orders / batches : 0.0, (orders > 0) ? (double) cookTime / orders : 0.0);
+    fprintf(fic, "throughput: %.1f orders/s of cooking, %.1f orders/s of chef lifetime\n",
+            (cookTime > 0) ? 1e6 * orders / cookTime : 0.0, (lifeTime > 0) ? 1e6 * orders / lifeTime : 0.0);
+}
+
+/**
+ *  \brief Printing the outcome of the kitchen pipeline.
+ *
+ *  One line per station with its utilization, the time-weighted length of its input queue (the first
+ *  station takes the orders of the waiter) and how often and for how long it was held back by a full
+ *  queue downstream. The most utilized station is the bottleneck; backpressure shows up upstream of it.
+ *
+ *  \param fic open stream
+ *  \param n number of stations
+ *  \param name name of each station
+ *  \param id entity id of each station
+ *  \param util busy/idle accounting, indexed by entity id
+ *  \param queue time-weighted length of the input queue of each station
+ *  \param blocked number of times each station found the next queue full
+ *  \param blockedTime time each station waited for room in the next queue (in microseconds)
+ */
+void printPipeline (FILE *fic, unsigned int n, char *name[], unsigned int id[], UTILIZATION util[],
+                    TIMEAVG queue[], unsigned long blocked[], unsigned long long blockedTime[])
+{
+    unsigned long long total, now = nowUSec();
+    unsigned int s;
+
+    fprintf(fic, "\nKitchen pipeline\n");
+    fprintf(fic, "%-8s %8s %8s %8s %12s\n", "station", "util(%)", "queue", "blocked", "blocked(ms)");
+    for (s = 0; s < n; s++) {
+        total = util[id[s]].busyTime + util[id[s]].idleTime;
+        fprintf(fic, "%-8s %8.1f", name[s], (total > 0) ? 100.0 * util[id[s]].busyTime / total : 0.0);
+        if (s == 0) {
+            fprintf(fic, " %8s", "-");
+        }
+        else fprintf(fic, " %8.2f", avgMean(&queue[s], now));
+        fprintf(fic, " %8lu %12.2f\n", blocked[s], blockedTime[s] / 1000.0);
+    }
+}
+
+/**
+ *  \brief Printing the trips made by the waiter.
+ *
+ *  \param fic open stream
+ *  \param requests number of requests served
+ *  \param trips number of trips they were served in
+ */
+void printTrips (FILE *fic, unsigned long requests, unsigned long trips)
+{
+    fprintf(fic, "\nWaiter\n");
+    fprintf(fic, "%lu requests in %lu trips (%.2f per trip)\n", requests, trips,
+            (trips > 0) ? (double) requests / trips : 0.0);
+}
+
+/**
+ *  \brief Printing the seating outcome per size class.
+ *
+ *  Seat utilization over the run and number of groups seated at tables pushed together, then one line
+ *  per group size present with the number of groups, the single tables they fit in and their check-in
+ *  latency (mean, 99th percentile and maximum, in microseconds).
+ *
+ *  \param fic open stream
+ *  \param nTables number of tables
+ *  \param seats number of seats of each table
+ *  \param nGroups number of groups
+ *  \param size number of people of each group
+ *  \param occupied time-weighted average number of occupied seats
+ *  \param wait check-in latency of each size class (indexed by size)
+ *  \param combined number of groups seated at tables pushed together
+ */
+void printSeating (FILE *fic, int nTables, int seats[], int nGroups, int size[], double occupied,
+                   LATENCY wait[], unsigned long combined)
+{
+    int total = 0, groups, tables, s, i;
+
+    for (i = 0; i < nTables; i++) {
+        total += seats[i];
+    }
+    fprintf(fic, "\nSeating\n");
+    fprintf(fic, "occupied seats (time-weighted avg): %.2f of %d (%.1f%%)\n", occupied, total,
+            (total > 0) ? 100.0 * occupied / total : 0.0);
+    fprintf(fic, "groups seated at tables pushed together: %lu\n", combined);
+    fprintf(fic, "%-6s %6s %6s %10s %10s %10s\n", "size", "groups", "tables", "wait", "p99", "max");
+    for (s = 1; s <= MAXSEATS; s++) {
+        for (groups = 0, i = 0; i < nGroups; i++) {
+            if (size[i] == s) groups++;
+        }
+        if (groups == 0) {
+            continue;                                                     /* size class not present */
+        }
+        for (tables = 0, i = 0; i < nTables; i++) {
+            if (seats[i] >= s) tables++;
+        }
+        fprintf(fic, "%-6d %6d %6d %10.1f %10llu %10llu\n", s, groups, tables,
+                (wait[s].count > 0) ? (double) wait[s].sum / wait[s].count : 0.0,
+                latPercentile(&wait[s], 99.0), wait[s].max);
+    }
+}
+
+/**
+ *  \brief Printing the outcome of the reservations.
+ *
+ *  Check-in latency of walk-in groups and of groups with a reservation, then how many reservations were
+ *  honored and dropped and for how long tables were held empty.
+ *
+ *  \param fic open stream
+ *  \param wait check-in latency of walk-in groups (0) and of groups with a reservation (1)
+ *  \param honored number of reservations honored (at the tables held for them or, if seated first, at others)
+ *  \param dropped number of reservations dropped because the group arrived too late or gave up
+ *  \param heldIdle time tables were held empty, summed over the tables (in microseconds)
+ */
+void printReservations (FILE *fic, LATENCY wait[], unsigned long honored, unsigned long dropped,
+                        unsigned long long heldIdle)
+{
+    char *name[2] = { "walk-in", "reservation" };
+    int c;
+
+    fprintf(fic, "\nReservations\n");
+    fprintf(fic, "%-12s %5s %10s %10s %10s\n", "check-in", "n", "mean", "p99", "max");
+    for (c = 0; c < 2; c++) {
+        fprintf(fic, "%-12s %5lu %10.1f %10llu %10llu\n", name[c], wait[c].count,
+                (wait[c].count > 0) ? (double) wait[c].sum / wait[c].count : 0.0,
+                latPercentile(&wait[c], 99.0), wait[c].max);
+    }
+    fprintf(fic, "%lu honored, %lu dropped, tables held empty for %.2f ms\n", honored, dropped,
+            heldIdle / 1000.0);
+}
+
+/**
+ *  \brief Printing the outcome of admission control.
+ *
+ *  How many groups left without a table, on arrival (balking) or after waiting (reneging), and how long
+ *  the latter waited (in microseconds).
+ *
+ *  \param fic open stream
+ *  \param nGroups number of groups
+ *  \param balked number of groups that left on arrival
+ *  \param renege time groups waited before leaving
+ */
+void printAdmission (FILE *fic, int nGroups, unsigned long balked, LATENCY *renege)
+{
+    fprintf(fic, "\nAdmission\n");
+    fprintf(fic, "%d groups: %lu seated, %lu balked, %lu reneged\n", nGroups,
+            (unsigned long) nGroups - balked - renege->count, balked, renege->count);
+    fprintf(fic, "reneged after (us): mean %.1f, p99 %llu, max %llu\n",
+            (renege->count > 0) ? (double) renege->sum / renege->count : 0.0, latPercentile(renege, 99.0),
+            renege->max);
+}
+
+/**
+ *  \brief Printing the throughput and latency of the reception.
+ *
+ *  Requests handled and utilization of each receptionist, requests per second over the run and the check-in
+ *  and check-out latencies (in microseconds). With table-side checkout, also the time until the tables of
+ *  the groups gone were freed.
+ *
+ *  \param fic open stream
+ *  \param n number of receptionists
+ *  \param handled number of requests handled by each receptionist
+ *  \param util busy/idle accounting of each receptionist
+ *  \param checkIn check-in latency
+ *  \param checkOut check-out latency
+ *  \param release table-side checkout until the tables are freed (no samples without table-side checkout)
+ */
+void printReception (FILE *fic, unsigned int n, unsigned long handled[], UTILIZATION util[],
+                     LATENCY *checkIn, LATENCY *checkOut, LATENCY *release)
+{
+    unsigned int k;
+    unsigned long requests = 0;
+    unsigned long long total, span = 0;
+
+    fprintf(fic, "\nReception\n");
+    fprintf(fic, "%-6s %10s %10s %8s\n", "#", "requests", "busy(ms)", "util(%)");
+    for (k = 0; k < n; k++) {
+        total = util[k].busyTime + util[k].idleTime;
+        if (total > span) span = total;
+        requests += handled[k];
+        fprintf(fic, "%-6u %10lu %10.2f %8.1f\n", k, handled[k], util[k].busyTime / 1000.0,
+                (total > 0) ? 100.0 * util[k].busyTime / total : 0.0);
+    }
+    fprintf(fic, "throughput: %.1f requests/s with %u receptionist%s\n",
+            (span > 0) ? 1e6 * requests / span : 0.0, n, (n > 1) ? "s" : "");
+    fprintf(fic, "check-in (us): mean %.1f, p99 %llu; check-out (us): mean %.1f, p99 %llu\n",
+            (checkIn->count > 0) ? (double) checkIn->sum / checkIn->count : 0.0, latPercentile(checkIn, 99.0),
+            (checkOut->count > 0) ? (double) checkOut->sum / checkOut->count : 0.0,
+            latPercentile(checkOut, 99.0));
+    if (release->count > 0) {
+        fprintf(fic, "%lu table-side checkouts, tables freed after (us): mean %.1f, p99 %llu, max %llu\n",
+                release->count, (double) release->sum / release->count, latPercentile(release, 99.0),
+                release->max);
+    }
+}
+
+/**
+ *  \brief Printing the work of the waiter of each zone.
+ *
+ *  Tables, requests served, trips and utilization of the waiter of each zone: an uneven load shows up as
+ *  one waiter busy while the others idle. With work stealing, also the requests each waiter took from other
+ *  zones and those of its zone taken by others.
+ *
+ *  \param fic open stream
+ *  \param n number of zones
+ *  \param nTables number of tables
+ *  \param tableZone zone of each table
+ *  \param requests number of requests served by the waiter of each zone
+ *  \param trips number of trips made by the waiter of each zone
+ *  \param steals number of requests the waiter of each zone took from other zones
+ *  \param stolen number of requests of each zone taken by the waiters of other zones
+ *  \param util busy/idle accounting of the waiter of each zone
+ */
+void printZones (FILE *fic, unsigned int n, int nTables, int tableZone[], unsigned long requests[],
+                 unsigned long trips[], unsigned long steals[], unsigned long stolen[], UTILIZATION util[])
+{
+    unsigned int z;
+    int t, tables;
+    unsigned long long total;
+
+    fprintf(fic, "\nWaiter zones\n");
+    fprintf(fic, "%-6s %6s %10s %8s %8s %8s %10s %8s\n", "zone", "tables", "requests", "trips", "stole", "lost",
+            "busy(ms)", "util(%)");
+    for (z = 0; z < n; z++) {
+        for (tables = 0, t = 0; t < nTables; t++) {
+            if (tableZone[t] == (int) z) tables++;
+        }
+        total = util[z].busyTime + util[z].idleTime;
+        fprintf(fic, "%-6u %6d %10lu %8lu %8lu %8lu %10.2f %8.1f\n", z, tables, requests[z], trips[z], steals[z],
+                stolen[z], util[z].busyTime / 1000.0, (total > 0) ? 100.0 * util[z].busyTime / total : 0.0);
+    }
+}
+
+/**
+ *  \brief Printing the work of the chef of each dish.
+ *
+ *  One line per dish with the orders cooked, the utilization of its chef, the time-weighted length of its
+ *  order queue and the time from the order being queued until it is cooked. The dish whose chef is the most
+ *  utilized, with the longest queue, is the bottleneck of the kitchen.
+ *
+ *  \param fic open stream
+ *  \param n number of dishes
+ *  \param util busy/idle accounting of the chef of each dish
+ *  \param queue time-weighted length of the order queue of each dish
+ *  \param lat order-to-cooked latency of each dish
+ */
+void printDishes (FILE *fic, unsigned int n, UTILIZATION util[], TIMEAVG queue[], LATENCY lat[])
+{
+    unsigned long long total, now = nowUSec();
+    unsigned int d;
+
+    fprintf(fic, "\nDishes\n");
+    fprintf(fic, "%-6s %8s %8s %8s %10s %10s\n", "dish", "orders", "util(%)", "queue", "mean(us)", "p99(us)");
+    for (d = 0; d < n; d++) {
+        total = util[d].busyTime + util[d].idleTime;
+        fprintf(fic, "%-6u %8lu %8.1f %8.2f %10.1f %10llu\n", d, lat[d].count,
+                (total > 0) ? 100.0 * util[d].busyTime / total : 0.0, avgMean(&queue[d], now),
+                (lat[d].count > 0) ? (double) lat[d].sum / lat[d].count : 0.0, latPercentile(&lat[d], 99.0));
+    }
+}
+
+/**
+ *  \brief Printing the outcome of elastic staffing.
+ *
+ *  Helpers spawned per role and retired, the largest number working at the same time and the time they were
+ *  on staff, summed over them, with how much of it they were busy: the cost of a staffing policy, to be
+ *  weighed against the latencies it achieves.
+ *
+ *  \param fic open stream
+ *  \param n number of helpers spawned
+ *  \param role role of each helper (WAITER_ID or CHEF_ID)
+ *  \param util busy/idle accounting of each helper
+ *  \param retired number of helpers retired
+ *  \param peak largest number of helpers working at the same time
+ */
+void printStaffing (FILE *fic, unsigned int n, unsigned int role[], UTILIZATION util[], unsigned int retired,
+                    unsigned int peak)
+{
+    unsigned int h, waiters = 0;
+    unsigned long long busy = 0, total = 0;
+
+    for (h = 0; h < n; h++) {
+        if (role[h] == WAITER_ID) waiters++;
+        busy += util[h].busyTime;
+        total += util[h].busyTime + util[h].idleTime;
+    }
+    fprintf(fic, "\nElastic staffing\n");
+    fprintf(fic, "%u helpers spawned (%u waiters, %u chefs), %u retired, at most %u working at once\n", n,
+            waiters, n - waiters, retired, peak);
+    fprintf(fic, "helper time: %.2f ms, %.1f%% busy\n", total / 1000.0, (total > 0) ? 100.0 * busy / total : 0.0);
+}
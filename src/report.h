@@ -0,0 +1,262 @@
+/**
+ *  \file report.h (interface file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  \brief Printing the run summary.
+ *
+ *  Defined operations:
+ *     \li accumulation of the resource usage of an entity into its role
+ *     \li printing the resource usage per role
+ *     \li printing the performance counters per role
+ *     \li printing the utilization of the service roles and the queueing averages
+ *     \li printing latency distributions
+ *     \li printing the outcome of spin-then-block waits per role
+ *     \li printing the batching outcome and throughput of the kitchen
+ *     \li printing the outcome of the kitchen pipeline
+ *     \li printing the trips made by the waiter
+ *     \li printing the seating outcome per size class
+ *     \li printing the outcome of the reservations
+ *     \li printing the outcome of admission control
+ *     \li printing the throughput and latency of the reception
+ *     \li printing the work of the waiter of each zone
+ *     \li printing the work of the chef of each dish
+ *     \li printing the outcome of elastic staffing.
+ */
+
+#ifndef REPORT_H_
+#define REPORT_H_
+
+#include <stdio.h>
+#include <sys/resource.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+
+/**
+ *  \brief Accumulation of the resource usage of an entity into its role.
+ *
+ *  CPU times, page faults and context switches are added up; the maximum resident set size is the
+ *  largest one among the entities of the role.
+ *
+ *  \param acc resource usage of the role
+ *  \param ru resource usage of the entity
+ */
+extern void addUsage (struct rusage *acc, struct rusage *ru);
+
+/**
+ *  \brief Printing the resource usage per role.
+ *
+ *  \param fic open stream
+ *  \param nRoles number of roles
+ *  \param role name of each role
+ *  \param n number of entities accounted in each role
+ *  \param ru resource usage of each role
+ *  \param semOps number of semaphore operations of each role
+ */
+extern void printUsage (FILE *fic, unsigned int nRoles, char *role[], unsigned int n[], struct rusage ru[],
+                        unsigned long semOps[]);
+
+/**
+ *  \brief Printing the performance counters per role.
+ *
+ *  \param fic open stream
+ *  \param nRoles number of roles
+ *  \param role name of each role
+ *  \param count counter totals of each role (-1 if not available)
+ */
+extern void printPerf (FILE *fic, unsigned int nRoles, char *role[], long long count[][NUMPERFCOUNTERS]);
+
+/**
+ *  \brief Printing the utilization of the service roles and the queueing averages.
+ *
+ *  \param fic open stream
+ *  \param nRoles number of service roles
+ *  \param role name of each role
+ *  \param util busy/idle accounting of each role
+ *  \param waiting time-weighted average number of groups waiting for a table
+ *  \param occupancy time-weighted average number of occupied tables
+ *  \param nTables number of tables
+ */
+extern void printUtilization (FILE *fic, unsigned int nRoles, char *role[], UTILIZATION util[],
+                              double waiting, double occupancy, unsigned int nTables);
+
+/**
+ *  \brief Printing latency distributions.
+ *
+ *  \param fic open stream
+ *  \param n number of latencies
+ *  \param name name of each latency
+ *  \param lat latency distributions
+ */
+extern void printLatencies (FILE *fic, unsigned int n, char *name[], LATENCY lat[]);
+
+/**
+ *  \brief Printing the outcome of spin-then-block waits per role.
+ *
+ *  \param fic open stream
+ *  \param nRoles number of roles
+ *  \param role name of each role
+ *  \param hits downs satisfied while spinning of each role
+ *  \param misses downs that had to block of each role
+ */
+extern void printSpin (FILE *fic, unsigned int nRoles, char *role[], unsigned long hits[], unsigned long misses[]);
+
+/**
+ *  \brief Printing the batching outcome and throughput of the kitchen.
+ *
+ *  \param fic open stream
+ *  \param orders number of orders cooked
+ *  \param batches number of batches they were cooked in
+ *  \param cookTime time spent cooking, summed over the burners (in microseconds)
+ *  \param lifeTime lifetime of the chef (in microseconds)
+ */
+extern void printKitchen (FILE *fic, unsigned long orders, unsigned long batches, unsigned long long cookTime,
+                          unsigned long long lifeTime);
+
+/**
+ *  \brief Printing the outcome of the kitchen pipeline.
+ *
+ *  One line per station with its utilization, the time-weighted length of its input queue (the first
+ *  station takes the orders of the waiter) and how often and for how long it was held back by a full
+ *  queue downstream. The most utilized station is the bottleneck; backpressure shows up upstream of it.
+ *
+ *  \param fic open stream
+ *  \param n number of stations
+ *  \param name name of each station
+ *  \param id entity id of each station
+ *  \param util busy/idle accounting, indexed by entity id
+ *  \param queue time-weighted length of the input queue of each station
+ *  \param blocked number of times each station found the next queue full
+ *  \param blockedTime time each station waited for room in the next queue (in microseconds)
+ */
+extern void printPipeline (FILE *fic, unsigned int n, char *name[], unsigned int id[], UTILIZATION util[],
+                           TIMEAVG queue[], unsigned long blocked[], unsigned long long blockedTime[]);
+
+/**
+ *  \brief Printing the trips made by the waiter.
+ *
+ *  \param fic open stream
+ *  \param requests number of requests served
+ *  \param trips number of trips they were served in
+ */
+extern void printTrips (FILE *fic, unsigned long requests, unsigned long trips);
+
+/**
+ *  \brief Printing the seating outcome per size class.
+ *
+ *  Seat utilization over the run and number of groups seated at tables pushed together, then one line
+ *  per group size present with the number of groups, the single tables they fit in and their check-in
+ *  latency.
+ *
+ *  \param fic open stream
+ *  \param nTables number of tables
+ *  \param seats number of seats of each table
+ *  \param nGroups number of groups
+ *  \param size number of people of each group
+ *  \param occupied time-weighted average number of occupied seats
+ *  \param wait check-in latency of each size class (indexed by size)
+ *  \param combined number of groups seated at tables pushed together
+ */
+extern void printSeating (FILE *fic, int nTables, int seats[], int nGroups, int size[], double occupied,
+                          LATENCY wait[], unsigned long combined);
+
+/**
+ *  \brief Printing the outcome of the reservations.
+ *
+ *  Check-in latency of walk-in groups and of groups with a reservation, then how many reservations were
+ *  honored and dropped and for how long tables were held empty.
+ *
+ *  \param fic open stream
+ *  \param wait check-in latency of walk-in groups (0) and of groups with a reservation (1)
+ *  \param honored number of reservations honored (at the tables held for them or, if seated first, at others)
+ *  \param dropped number of reservations dropped because the group arrived too late or gave up
+ *  \param heldIdle time tables were held empty, summed over the tables (in microseconds)
+ */
+extern void printReservations (FILE *fic, LATENCY wait[], unsigned long honored, unsigned long dropped,
+                               unsigned long long heldIdle);
+
+/**
+ *  \brief Printing the outcome of admission control.
+ *
+ *  How many groups left without a table, on arrival (balking) or after waiting (reneging), and how long
+ *  the latter waited (in microseconds).
+ *
+ *  \param fic open stream
+ *  \param nGroups number of groups
+ *  \param balked number of groups that left on arrival
+ *  \param renege time groups waited before leaving
+ */
+extern void printAdmission (FILE *fic, int nGroups, unsigned long balked, LATENCY *renege);
+
+/**
+ *  \brief Printing the throughput and latency of the reception.
+ *
+ *  Requests handled and utilization of each receptionist, requests per second over the run and the check-in
+ *  and check-out latencies (in microseconds). With table-side checkout, also the time until the tables of
+ *  the groups gone were freed.
+ *
+ *  \param fic open stream
+ *  \param n number of receptionists
+ *  \param handled number of requests handled by each receptionist
+ *  \param util busy/idle accounting of each receptionist
+ *  \param checkIn check-in latency
+ *  \param checkOut check-out latency
+ *  \param release table-side checkout until the tables are freed (no samples without table-side checkout)
+ */
+extern void printReception (FILE *fic, unsigned int n, unsigned long handled[], UTILIZATION util[],
+                            LATENCY *checkIn, LATENCY *checkOut, LATENCY *release);
+
+/**
+ *  \brief Printing the work of the waiter of each zone.
+ *
+ *  Tables, requests served, trips and utilization of the waiter of each zone: an uneven load shows up as
+ *  one waiter busy while the others idle. With work stealing, also the requests each waiter took from other
+ *  zones and those of its zone taken by others.
+ *
+ *  \param fic open stream
+ *  \param n number of zones
+ *  \param nTables number of tables
+ *  \param tableZone zone of each table
+ *  \param requests number of requests served by the waiter of each zone
+ *  \param trips number of trips made by the waiter of each zone
+ *  \param steals number of requests the waiter of each zone took from other zones
+ *  \param stolen number of requests of each zone taken by the waiters of other zones
+ *  \param util busy/idle accounting of the waiter of each zone
+ */
+extern void printZones (FILE *fic, unsigned int n, int nTables, int tableZone[], unsigned long requests[],
+                        unsigned long trips[], unsigned long steals[], unsigned long stolen[], UTILIZATION util[]);
+
+/**
+ *  \brief Printing the work of the chef of each dish.
+ *
+ *  One line per dish with the orders cooked, the utilization of its chef, the time-weighted length of its
+ *  order queue and the time from the order being queued until it is cooked. The dish whose chef is the most
+ *  utilized, with the longest queue, is the bottleneck of the kitchen.
+ *
+ *  \param fic open stream
+ *  \param n number of dishes
+ *  \param util busy/idle accounting of the chef of each dish
+ *  \param queue time-weighted length of the order queue of each dish
+ *  \param lat order-to-cooked latency of each dish
+ */
+extern void printDishes (FILE *fic, unsigned int n, UTILIZATION util[], TIMEAVG queue[], LATENCY lat[]);
+
+/**
+ *  \brief Printing the outcome of elastic staffing.
+ *
+ *  Helpers spawned per role and retired, the largest number working at the same time and the time they were
+ *  on staff, summed over them, with how much of it they were busy: the cost of a staffing policy, to be
+ *  weighed against the latencies it achieves.
+ *
+ *  \param fic open stream
+ *  \param n number of helpers spawned
+ *  \param role role of each helper (WAITER_ID or CHEF_ID)
+ *  \param util busy/idle accounting of each helper
+ *  \param retired number of helpers retired
+ *  \param peak largest number of helpers working at the same time
+ */
+extern void printStaffing (FILE *fic, unsigned int n, unsigned int role[], UTILIZATION util[], unsigned int retired,
+                           unsigned int peak);
+
+#endif /* REPORT_H_ */
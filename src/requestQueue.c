@@ -0,0 +1,120 @@
+/**
+ *  \file requestQueue.c (implementation file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  \brief Queues of requests in shared memory.
+ *
+ *  The queues have no synchronization of their own: they must be operated within the critical region.
+ *  Optionally, the consumer is notified of new requests through an eventfd.
+ *
+ *  Defined operations:
+ *     \li initialization of a queue
+ *     \li insertion of a request at the tail
+ *     \li removal of the request at the head
+ *     \li removal of the request at the tail
+ *     \li notification of new requests through an eventfd
+ *     \li consumption of the notifications of an eventfd.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "requestQueue.h"
+
+/**
+ *  \brief Initialization of a queue (the queue becomes empty).
+ *
+ *  \param q queue
+ */
+void rqInit (REQQUEUE *q)
+{
+    q->head = q->count = 0;
+}
+
+/**
+ *  \brief Insertion of a request at the tail.
+ *
+ *  \param q queue
+ *  \param req request
+ *
+ *  \return true upon success, false if the queue is full
+ */
+bool rqPush (REQQUEUE *q, request req)
+{
+    if (q->count == QUEUESIZE) {
+        return false;
+    }
+    q->item[(q->head + q->count) % QUEUESIZE] = req;
+    q->count += 1;
+    return true;
+}
+
+/**
+ *  \brief Removal of the request at the head.
+ *
+ *  \param q queue
+ *  \param req location where the request is stored
+ *
+ *  \return true upon success, false if the queue is empty
+ */
+bool rqPop (REQQUEUE *q, request *req)
+{
+    if (q->count == 0) {
+        return false;
+    }
+    *req = q->item[q->head];
+    q->head = (q->head + 1) % QUEUESIZE;
+    q->count -= 1;
+    return true;
+}
+
+/**
+ *  \brief Removal of the request at the tail (the newest one, as taken by another consumer that steals it).
+ *
+ *  \param q queue
+ *  \param req location where the request is stored
+ *
+ *  \return true upon success, false if the queue is empty
+ */
+bool rqSteal (REQQUEUE *q, request *req)
+{
+    if (q->count == 0) {
+        return false;
+    }
+    q->count -= 1;
+    *req = q->item[(q->head + q->count) % QUEUESIZE];
+    return true;
+}
+
+/**
+ *  \brief Notification of new requests through an eventfd.
+ *
+ *  \param fd eventfd descriptor
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int rqNotify (int fd)
+{
+    uint64_t one = 1;
+
+    return (write(fd, &one, sizeof (one)) == sizeof (one)) ? 0 : -1;
+}
+
+/**
+ *  \brief Consumption of the notifications of an eventfd (the eventfd counter is reset).
+ *
+ *  \param fd eventfd descriptor (non blocking)
+ *
+ *  \return number of notifications consumed
+ */
+unsigned long rqConsume (int fd)
+{
+    uint64_t n;
+
+    return (read(fd, &n, sizeof (n)) == sizeof (n)) ? (unsigned long) n : 0;
+}
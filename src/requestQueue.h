@@ -0,0 +1,83 @@
+/**
+ *  \file requestQueue.h (interface file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  \brief Queues of requests in shared memory.
+ *
+ *  The queues have no synchronization of their own: they must be operated within the critical region.
+ *  Optionally, the consumer is notified of new requests through an eventfd.
+ *
+ *  Defined operations:
+ *     \li initialization of a queue
+ *     \li insertion of a request at the tail
+ *     \li removal of the request at the head
+ *     \li removal of the request at the tail
+ *     \li notification of new requests through an eventfd
+ *     \li consumption of the notifications of an eventfd.
+ */
+
+#ifndef REQUESTQUEUE_H_
+#define REQUESTQUEUE_H_
+
+#include <stdbool.h>
+
+#include "probDataStruct.h"
+
+/**
+ *  \brief Initialization of a queue (the queue becomes empty).
+ *
+ *  \param q queue
+ */
+extern void rqInit (REQQUEUE *q);
+
+/**
+ *  \brief Insertion of a request at the tail.
+ *
+ *  \param q queue
+ *  \param req request
+ *
+ *  \return true upon success, false if the queue is full
+ */
+extern bool rqPush (REQQUEUE *q, request req);
+
+/**
+ *  \brief Removal of the request at the head.
+ *
+ *  \param q queue
+ *  \param req location where the request is stored
+ *
+ *  \return true upon success, false if the queue is empty
+ */
+extern bool rqPop (REQQUEUE *q, request *req);
+
+/**
+ *  \brief Removal of the request at the tail (the newest one, as taken by another consumer that steals it).
+ *
+ *  \param q queue
+ *  \param req location where the request is stored
+ *
+ *  \return true upon success, false if the queue is empty
+ */
+extern bool rqSteal (REQQUEUE *q, request *req);
+
+/**
+ *  \brief Notification of new requests through an eventfd.
+ *
+ *  \param fd eventfd descriptor
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+extern int rqNotify (int fd);
+
+/**
+ *  \brief Consumption of the notifications of an eventfd (the eventfd counter is reset).
+ *
+ *  \param fd eventfd descriptor (non blocking)
+ *
+ *  \return number of notifications consumed
+ */
+extern unsigned long rqConsume (int fd);
+
+#endif /* REQUESTQUEUE_H_ */
@@ -6,8 +6,12 @@
  *  Synchronization based on semaphores and shared memory.
  *  Implementation with SVIPC.
  *
- *  Definition of the operations carried out by the chef:
+ *  Definition of the operations carried out by the chef of a dish (or by a
+ *  station of the kitchen pipeline):
  *     \li waitOrder
+ *     \li serviceTime
+ *     \li startCooking
+ *     \li nextCompletion
  *     \li processOrder
  *
  *  \author Nuno Lau - December 2023
@@ -30,6 +34,10 @@
 #include "semaphore.h"
 #include "sharedDataSync.h"
 #include "sharedMemory.h"
+#include "watchdog.h"
+#include "perfCounters.h"
+#include "metrics.h"
+#include "requestQueue.h"
 
 /** \brief logging file name */
 static char nFic[51];
@@ -40,14 +48,75 @@ static int shmid;
 /** \brief semaphore set access identifier */
 static int semgid;
 
-/** \brief group that requested cooking food */
-static int lastGroup;
+/**
+ *  \brief Definition of a burner, cooking one batch of orders
+ */
+typedef struct {
+  /** \brief groups whose food is being cooked */
+  int batch[MAXGROUPS];
+  /** \brief number of groups in the batch (0 if the burner is free) */
+  int count;
+  /** \brief time taken to cook the batch (in microseconds) */
+  unsigned int cookTime;
+  /** \brief time at which the batch will be cooked */
+  unsigned long long due;
+  /** \brief next burner in the same slot of the timer wheel (-1 if none) */
+  int next;
+} BURNER;
+
+/** \brief burners of the kitchen */
+static BURNER burner[MAXBURNERS];
+
+/** \brief number of burners cooking */
+static int cooking;
+
+/** \brief timer wheel: first burner due in each slot (-1 if none) */
+static int wheel[WHEELSLOTS];
+
+/** \brief time up to which the timer wheel was expired */
+static unsigned long long cursor;
+
+/** \brief groups of the orders taken by the last waitForOrder */
+static int batch[MAXGROUPS];
+
+/** \brief station run by the process (STATION_ALL runs the whole kitchen) */
+static int station;
+
+/** \brief dish cooked by the process (dish 0 in the kitchen pipeline) */
+static int dish;
+
+/** \brief number of the chef among the helpers spawned by the generator (-1 if it is not a helper) */
+static int helper;
+
+/** \brief entity id of the station */
+static unsigned int self;
+
+/** \brief the station cooks (the chef settings apply and its state is saved) */
+static bool cooks;
+
+/** \brief number of burners of the station */
+static int burners;
+
+/** \brief batch size of the station */
+static int batchSize;
+
+/** \brief batching window of the station (in microseconds) */
+static unsigned int batchWindow;
+
+/** \brief semaphore counting the work queued to the station */
+static unsigned int inItems;
+
+/** \brief queue where the work of the station is taken from */
+static REQQUEUE *inQueue;
 
 /** \brief pointer to shared memory region */
 static SHARED_DATA *sh;
 
-static void waitForOrder();
-static void processOrder();
+static int waitForOrder(unsigned long long until);
+static unsigned int serviceTime(int n);
+static void startCooking(int n);
+static unsigned long long nextCompletion();
+static int processOrder(unsigned long long now);
 
 /**
  *  \brief Main program.
@@ -61,7 +130,7 @@ int main(int argc, char *argv[]) {
 
   /* validation of command line parameters */
 
-  if (argc != 4) {
+  if (argc != 7) {
     freopen("error_CH", "a", stderr);
     fprintf(stderr, "Number of parameters is incorrect!\n");
     return EXIT_FAILURE;
@@ -75,6 +144,22 @@ int main(int argc, char *argv[]) {
     fprintf(stderr, "Error on the access key communication!\n");
     return EXIT_FAILURE;
   }
+  station = (int)strtol(argv[4], &tinp, 0);
+  if ((*tinp != '\0') || (station < 0) || (station > STATION_ALL)) {
+    fprintf(stderr, "Station value is out of range!\n");
+    return EXIT_FAILURE;
+  }
+  dish = (int)strtol(argv[5], &tinp, 0);
+  if ((*tinp != '\0') || (dish < 0) || (dish >= MAXDISHES)) {
+    fprintf(stderr, "Dish value is out of range!\n");
+    return EXIT_FAILURE;
+  }
+  helper = (int)strtol(argv[6], &tinp, 0);
+  if ((*tinp != '\0') || (helper < -1) || (helper >= MAXHELPERS) ||
+      ((helper >= 0) && (station != STATION_ALL))) {
+    fprintf(stderr, "Helper value is out of range!\n");
+    return EXIT_FAILURE;
+  }
 
   /* connection to the semaphore set and the shared memory region and mapping
      the shared region onto the process address space */
@@ -91,17 +176,87 @@ int main(int argc, char *argv[]) {
     return EXIT_FAILURE;
   }
 
+  /* settings and channels of the station: the chef settings only apply to
+     the cook station; each station takes its work from its input queue (the
+     first one from the orders of the waiter for its dish) */
+  self = (helper >= 0)                ? HELPERS_ID + (unsigned int)helper
+         : (station == STATION_PREP)  ? PREP_ID
+         : (station == STATION_PLATE) ? PLATE_ID
+         : (dish > 0)                 ? CHEFS_ID + (unsigned int)(dish - 1)
+                                      : CHEF_ID;
+  cooks = (station == STATION_ALL) || (station == STATION_COOK);
+  burners = batchSize = 1;
+  batchWindow = 0;
+  if (cooks) {
+    burners = (int)sh->fSt.burners;
+    batchSize = (int)sh->fSt.batchSize;
+    batchWindow = sh->fSt.batchWindow;
+  }
+  if ((station == STATION_ALL) || (station == STATION_PREP)) {
+    inItems = sh->waitOrder[dish];
+    inQueue = &sh->fSt.orderQueue[dish];
+  } else {
+    inItems = sh->stationItems[station];
+    inQueue = &sh->fSt.stationQueue[station];
+  }
+
+  /* register entity for stall detection */
+  watchdogInit(sh, self);
+
+  /* spin-then-block waiting, if requested */
+  if (sh->fSt.spinMax > 0) {
+    semSpinEnable(sh->semShadow, sh->fSt.spinMax);
+  }
+
   /* initialize random generator */
   srandom((unsigned int)getpid());
 
+  /* start counting hardware events, if requested */
+  if (sh->fSt.perfCounters) {
+    perfStart();
+  }
+
+  /* start busy/idle accounting */
+  utilStart(&sh->util[self]);
+
   /* simulation of the life cycle of the chef */
 
-  int nOrders = 0;
-  while (nOrders < sh->fSt.nGroups) {
-    waitForOrder();
-    processOrder();
+  // The chef waits for new orders while a burner is free (until the next
+  // dish is cooked, if any is cooking) and otherwise for the next dish,
+  // until the restaurant closes and nothing is left cooking. A helper waits
+  // at most a sampling period of the generator, to stop taking orders once it
+  // is retired.
+  bool open = true;
+  int n, b, s;
+  unsigned long long due, now;
+  for (b = 0; b < (int)burners; b++)
+    burner[b].count = 0;
+  for (s = 0; s < WHEELSLOTS; s++)
+    wheel[s] = -1;
+  cooking = 0;
+  cursor = nowUSec();
+  while (open || (cooking > 0)) {
+    due = (cooking > 0) ? nextCompletion() : 0;
+    if (open && (cooking < (int)burners)) {
+      if ((helper >= 0) && (due == 0))
+        due = nowUSec() + sh->fSt.elasticPeriod;
+      if ((n = waitForOrder(due)) > 0)
+        startCooking(n);
+      else if ((n < 0) ||
+               ((helper >= 0) &&
+                __atomic_load_n(&sh->retire[helper], __ATOMIC_SEQ_CST)))
+        open = false;
+    } else if ((now = nowUSec()) < due)
+      usleep((unsigned int)(due - now));
+    processOrder(nowUSec());
+  }
 
-    nOrders++;
+  /* publishing accounting data */
+  utilStop(&sh->util[self]);
+  sh->semOps[self] = semOpCount();
+  semSpinStats(&sh->spinHits[self], &sh->spinMisses[self]);
+  if (sh->fSt.perfCounters) {
+    perfStop(sh->perfCount[self]);
   }
 
   /* unmapping the shared region off the process address space */
@@ -119,82 +274,319 @@ int main(int argc, char *argv[]) {
 /**
  *  \brief chefs wait for a food order.
  *
- *  The chef waits for the food request that will be provided by the waiter.
+ *  The chef waits for the food request that will be queued by the waiter,
+ *  then collects further orders into a batch: those already queued and those
+ *  arriving within the batching window, up to the batch size.
  *  Updates its state and saves internal state.
- *  Received order should be acknowledged.
+ *  Taking the orders from the queue acknowledges them (the waiter does not
+ * wait).
+ *
+ *  \param until time at which a dish will be cooked, or a helper has to check
+ * whether it is retired (0 if neither): the chef does not wait for orders past
+ * it
+ *
+ *  \return number of orders in the batch (0 if none arrived in time, -1 once
+ * the restaurant is closing)
  */
-static void waitForOrder() {
+static int waitForOrder(unsigned long long until) {
+  unsigned long long deadline, now;
+  int n;
 
   // First we need to see if there is an order pending
-  if (semDown(semgid, sh->waitOrder) == -1) {
-    perror("error on the up operation for semaphore access (PT)");
-    exit(EXIT_FAILURE);
+  if (until == 0) {
+    if (semDownWatched(semgid, inItems) == -1) {
+      perror("error on the up operation for semaphore access (PT)");
+      exit(EXIT_FAILURE);
+    }
+  } else {
+    now = nowUSec();
+    if (semDownTimed(semgid, inItems,
+                     (now < until) ? (unsigned int)(until - now) : 0) == -1) {
+      if (errno != EAGAIN) {
+        perror("error on the down operation for semaphore access (PT)");
+        exit(EXIT_FAILURE);
+      }
+      return 0;
+    }
   }
 
-  if (semDown(semgid, sh->mutex) == -1) { /* enter critical region */
+  // Then we gather the rest of the batch, without waiting past the window
+  deadline = nowUSec() + batchWindow;
+  if ((until != 0) && (until < deadline))
+    deadline = until;
+  for (n = 1; n < batchSize; n++) {
+    now = nowUSec();
+    if (semDownTimed(semgid, inItems,
+                     (now < deadline) ? (unsigned int)(deadline - now) : 0) ==
+        -1) {
+      if (errno != EAGAIN) {
+        perror("error on the down operation for semaphore access (PT)");
+        exit(EXIT_FAILURE);
+      }
+      break;
+    }
+  }
+
+  if (semDownWatched(semgid, sh->mutex) == -1) { /* enter critical region */
     perror("error on the up operation for semaphore access (PT)");
     exit(EXIT_FAILURE);
   }
 
-  // Now we can start processing the order and alter the corresponding state
-  lastGroup = sh->fSt.foodGroup;
-  sh->fSt.foodOrder = 0;
-  sh->fSt.st.chefStat = COOK;
-  saveState(nFic, &sh->fSt);
+  // Now we can take the oldest orders and alter the corresponding state;
+  // taking them out of the queue is the acknowledgement, nobody waits for it.
+  // A wakeup with nothing queued can only be the generator closing.
+  request order;
+  int i;
+  for (i = 0; (i < n) && rqPop(inQueue, &order); i++)
+    batch[i] = order.reqGroup;
+  if ((i < n) && !sh->closing) {
+    fprintf(stderr, "order queue is empty (PT)\n");
+    exit(EXIT_FAILURE);
+  }
+  if (i == 0) {
+    if (semUp(semgid, sh->mutex) == -1) { /* exit critical region */
+      perror("error on the up operation for semaphore access (PT)");
+      exit(EXIT_FAILURE);
+    }
+    // The closing wakeup is passed on to the other chefs of the dish
+    for (; n > 0; n--)
+      if (semUp(semgid, inItems) == -1) {
+        perror("error on the up operation for semaphore access (PT)");
+        exit(EXIT_FAILURE);
+      }
+    return -1;
+  }
+  n = i;
+  if (inQueue == &sh->fSt.orderQueue[dish]) {
+    sh->fSt.foodOrder -= n;
+    avgSet(&sh->orderQueueAvg[dish], inQueue->count);
+  } else
+    avgSet(&sh->stationQueueAvg[station], inQueue->count);
+  if (cooks) {
+    sh->fSt.st.chefStat = COOK;
+    saveState(nFic, &sh->fSt);
+  }
+  utilBusy(&sh->util[self], true);
 
   if (semUp(semgid, sh->mutex) == -1) { /* exit critical region */
     perror("error on the up operation for semaphore access (PT)");
     exit(EXIT_FAILURE);
   }
 
-  // Now we need to acknowledge that the order was received
-  if (semUp(semgid, sh->orderReceived) == -1) {
-    perror("error on the up operation for semaphore access (PT)");
-    exit(EXIT_FAILURE);
+  // Room is made in the queue of the station for the upstream one
+  if (inQueue != &sh->fSt.orderQueue[dish])
+    for (i = 0; i < n; i++)
+      if (semUp(semgid, sh->stationSlots[station]) == -1) {
+        perror("error on the up operation for semaphore access (PT)");
+        exit(EXIT_FAILURE);
+      }
+
+  return n;
+}
+
+/**
+ *  \brief time the station takes to serve a batch
+ *
+ *  Prep times are uniform and plate times exponential; cooking the whole
+ *  batch takes the time of one dish plus a fraction of it for each
+ *  additional dish, scaled by the cook time of the dish of the chef.
+ *
+ *  \param n number of orders in the batch
+ *
+ *  \return service time (in microseconds)
+ */
+static unsigned int serviceTime(int n) {
+  switch (station) {
+  case STATION_PREP:
+    return (unsigned int)floor(PREPMIN + (PREPVAR * (double)random()) / RAND_MAX);
+  case STATION_PLATE:
+    return (unsigned int)floor(
+        -PLATEMEAN * log((random() + 1.0) / ((double)RAND_MAX + 1.0)));
+  default:
+    return (unsigned int)floor(((MAXCOOK * random()) / RAND_MAX + 100.0) *
+                               (100 + (n - 1) * BATCHCOOK) / 100 *
+                               sh->fSt.dishCook[dish] / 100);
   }
 }
 
 /**
- *  \brief chef cooks, then delivers the food to the waiter
+ *  \brief chef puts the batch just taken on a free burner
  *
- *  The chef takes some time to cook and signals the waiter that food is
- *  ready (this may only happen when waiter is available)
- *  then updates its state.
+ *  The burner is scheduled on the timer wheel, in the slot of the tick in
+ *  which it will be done.
+ *
+ *  \param n number of orders in the batch
+ */
+static void startCooking(int n) {
+  int b, s;
+
+  for (b = 0; burner[b].count != 0; b++)
+    ;
+  memcpy(burner[b].batch, batch, (size_t)n * sizeof(int));
+  burner[b].count = n;
+  burner[b].cookTime = serviceTime(n);
+  burner[b].due = nowUSec() + burner[b].cookTime;
+  s = (int)((burner[b].due / WHEELTICK) % WHEELSLOTS);
+  burner[b].next = wheel[s];
+  wheel[s] = b;
+  cooking += 1;
+}
+
+/**
+ *  \brief time at which the next dish will be cooked
+ *
+ *  The wheel is scanned from the slot of the tick it was last expired up to;
+ *  a slot may hold burners due in later turns of the wheel, so the earliest
+ *  time is kept. Must only be called while some burner is cooking.
+ *
+ *  \return completion time of the earliest burner
+ */
+static unsigned long long nextCompletion() {
+  unsigned long long tick = cursor / WHEELTICK, due = 0;
+  int s, b;
+
+  for (s = 0; s < WHEELSLOTS; s++) {
+    for (b = wheel[(tick + s) % WHEELSLOTS]; b != -1; b = burner[b].next)
+      if ((due == 0) || (burner[b].due < due))
+        due = burner[b].due;
+    // a due time within this turn cannot be beaten by a later slot
+    if ((due != 0) && (due < (tick + s + 1) * WHEELTICK))
+      break;
+  }
+  return due;
+}
+
+/**
+ *  \brief chef delivers the food that is cooked to the waiter
+ *
+ *  The wheel is advanced slot by slot up to the present tick and the burners
+ *  that are done are taken off it. Their work is handed over at once: by the
+ *  last station, as food ready notices to the waiter of the zone of each
+ *  group; by any other station of the pipeline, to the queue of the next one,
+ *  first waiting for room in it (backpressure). Then the state is updated.
  *  The internal state should be saved.
+ *
+ *  \param now present time
+ *
+ *  \return number of orders delivered
  */
-static void processOrder() {
-  usleep((unsigned int)floor((MAXCOOK * random()) / RAND_MAX + 100.0));
+static int processOrder(unsigned long long now) {
+  int done[MAXBURNERS];
+  int nDone = 0, n = 0, *link, b, i, zone = 0;
+  int zoneItems[MAXWAITERS] = {0};
+  unsigned long long tick, last = now / WHEELTICK, t0;
+  bool final = (station == STATION_ALL) || (station == STATION_PLATE);
+  int next = station + 1;
   request req;
 
-  // First lets start by checking whether or not the waiter is available
-  if (semDown(semgid, sh->waiterRequestPossible) == -1) {
+  // First we take off the wheel every burner that is done, visiting each
+  // slot at most once
+  tick = cursor / WHEELTICK;
+  if (last - tick >= WHEELSLOTS)
+    tick = last - WHEELSLOTS + 1;
+  for (; tick <= last; tick++)
+    for (link = &wheel[tick % WHEELSLOTS]; *link != -1;)
+      if (burner[*link].due <= now) {
+        done[nDone++] = *link;
+        *link = burner[*link].next;
+      } else
+        link = &burner[*link].next;
+  cursor = now;
+  if (nDone == 0)
+    return 0;
+  for (b = 0; b < nDone; b++)
+    n += burner[done[b]].count;
+
+  // A station of the pipeline needs room in the queue of the next one
+  if (!final)
+    for (i = 0; i < n; i++)
+      if (semDownTimed(semgid, sh->stationSlots[next], 0) == -1) {
+        if (errno != EAGAIN) {
+          perror("error on the down operation for semaphore access (PT)");
+          exit(EXIT_FAILURE);
+        }
+        sh->stationBlocked[station] += 1;
+        t0 = nowUSec();
+        if (semDownWatched(semgid, sh->stationSlots[next]) == -1) {
+          perror("error on the down operation for semaphore access (PT)");
+          exit(EXIT_FAILURE);
+        }
+        sh->stationBlockedTime[station] += nowUSec() - t0;
+      }
+
+  if (semDownWatched(semgid, sh->mutex) == -1) { /* enter critical region */
     perror("error on the up operation for semaphore access (PT)");
     exit(EXIT_FAILURE);
   }
 
-  if (semDown(semgid, sh->mutex) == -1) { /* enter critical region */
-    perror("error on the up operation for semaphore access (PT)");
-    exit(EXIT_FAILURE);
+  // We can now start by formulating the requests and give them to the waiter
+  // (or to the next station)
+  req.reqType = final ? FOODREADY : FOODREQ;
+  req.reqDish = dish;
+  for (b = 0; b < nDone; b++) {
+    BURNER *bn = &burner[done[b]];
+    for (i = 0; i < bn->count; i++) {
+      req.reqGroup = bn->batch[i];
+      if (final) {
+        sh->cookedAt[bn->batch[i]] = bn->due;
+        latAdd(&sh->latency[LAT_KITCHEN],
+               bn->due - sh->orderedAt[bn->batch[i]]);
+        latAdd(&sh->dishLatency[dish], bn->due - sh->orderedAt[bn->batch[i]]);
+      }
+      if (final)
+        zoneItems[zone = sh->fSt.tableZone[sh->fSt.assignedTable[req.reqGroup]]]++;
+      if (!rqPush(final ? &sh->fSt.foodReadyQueue[zone] : &sh->fSt.stationQueue[next],
+                  req)) {
+        fprintf(stderr, "food ready queue is full (PT)\n");
+        exit(EXIT_FAILURE);
+      }
+    }
+    if (cooks) {
+      sh->batches += 1;
+      sh->cookTime += bn->cookTime;
+    }
+    bn->count = 0;
   }
-
-  // We can now start by formulating the request
-  req.reqGroup = lastGroup;
-  req.reqType = FOODREADY;
-  // And give the request to the waiter
-  sh->fSt.waiterRequest = req;
+  if (!final)
+    avgSet(&sh->stationQueueAvg[next], sh->fSt.stationQueue[next].count);
+  cooking -= nDone;
 
   // Now we update the chef's state
-  sh->fSt.st.chefStat = WAIT_FOR_ORDER;
-  saveState(nFic, &sh->fSt);
+  if (cooking == 0) {
+    if (cooks) {
+      sh->fSt.st.chefStat = WAIT_FOR_ORDER;
+      saveState(nFic, &sh->fSt);
+    }
+    utilBusy(&sh->util[self], false);
+  }
 
   if (semUp(semgid, sh->mutex) == -1) { /* exit critical region */
     perror("error on the up operation for semaphore access (PT)");
     exit(EXIT_FAILURE);
   }
 
-  // Now we signal the waiter that he has a new request
-  if (semUp(semgid, sh->waiterRequest) == -1) {
-    perror("error on the up operation for semaphore access (PT)");
-    exit(EXIT_FAILURE);
-  }
+  // Now we signal the waiter that he has new requests (or the next station
+  // that it has work)
+  if (!final) {
+    for (i = 0; i < n; i++)
+      if (semUp(semgid, sh->stationItems[next]) == -1) {
+        perror("error on the up operation for semaphore access (PT)");
+        exit(EXIT_FAILURE);
+      }
+  } else
+    for (zone = 0; zone < (int)sh->fSt.nWaiters; zone++) {
+      if (sh->fSt.waiterEvents) {
+        if ((zoneItems[zone] > 0) && (rqNotify(sh->foodReadyEvent[zone]) == -1)) {
+          perror("error on the notification of the waiter (PT)");
+          exit(EXIT_FAILURE);
+        }
+      } else
+        for (i = 0; i < zoneItems[zone]; i++)
+          if (semUp(semgid, sh->waiterRequest[zone]) == -1) {
+            perror("error on the up operation for semaphore access (PT)");
+            exit(EXIT_FAILURE);
+          }
+    }
+
+  return n;
 }
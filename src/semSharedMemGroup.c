@@ -9,6 +9,7 @@
  *  Definition of the operations carried out by the groups:
  *     \li goToRestaurant
  *     \li checkInAtReception
+ *     \li renege
  *     \li orderFood
  *     \li waitFood
  *     \li eat
@@ -17,6 +18,7 @@
  *  \author Nuno Lau - December 2023
  */
 
+#include <errno.h>
 #include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -31,6 +33,10 @@
 #include "semaphore.h"
 #include "sharedDataSync.h"
 #include "sharedMemory.h"
+#include "watchdog.h"
+#include "perfCounters.h"
+#include "metrics.h"
+#include "requestQueue.h"
 
 /** \brief logging file name */
 static char nFic[51];
@@ -44,9 +50,13 @@ static int semgid;
 /** \brief pointer to shared memory region */
 static SHARED_DATA *sh;
 
+/** \brief time the food request was issued (used to measure latencies) */
+static unsigned long long foodRequestTime;
+
 static void goToRestaurant(int id);
-static void checkInAtReception(int id);
-static void orderFood(int id);
+static bool checkInAtReception(int id);
+static bool renege(int id);
+static void orderFood(int id, unsigned int course);
 static void waitFood(int id);
 static void eat(int id);
 static void checkOutAtReception(int id);
@@ -99,16 +109,39 @@ int main(int argc, char *argv[]) {
     return EXIT_FAILURE;
   }
 
+  /* register entity for stall detection */
+  watchdogInit(sh, GROUP_ID + n);
+
+  /* spin-then-block waiting, if requested */
+  if (sh->fSt.spinMax > 0) {
+    semSpinEnable(sh->semShadow, sh->fSt.spinMax);
+  }
+
   /* initialize random generator */
   srandom((unsigned int)getpid());
 
+  /* start counting hardware events, if requested */
+  if (sh->fSt.perfCounters) {
+    perfStart();
+  }
+
   /* simulation of the life cycle of the group */
   goToRestaurant(n);
-  checkInAtReception(n);
-  orderFood(n);
-  waitFood(n);
-  eat(n);
-  checkOutAtReception(n);
+  if (checkInAtReception(n)) {
+    for (unsigned int c = 0; c < sh->fSt.courses; c++) {
+      orderFood(n, c);
+      waitFood(n);
+      eat(n);
+    }
+    checkOutAtReception(n);
+  }
+
+  /* publishing accounting data */
+  sh->semOps[GROUP_ID + n] = semOpCount();
+  semSpinStats(&sh->spinHits[GROUP_ID + n], &sh->spinMisses[GROUP_ID + n]);
+  if (sh->fSt.perfCounters) {
+    perfStop(sh->perfCount[GROUP_ID + n]);
+  }
 
   /* unmapping the shared region off the process address space */
   if (shmemDettach(sh) == -1) {
@@ -143,12 +176,15 @@ static double normalRand(double stddev) {
 /**
  *  \brief group goes to restaurant
  *
- *  The group takes its time to get to restaurant.
+ *  The group takes its time to get to restaurant. Start times count from the
+ *  opening of the restaurant, as the arrival windows of reservations do, not
+ *  from the start of the group process.
  *
  *  \param id group id
  */
 static void goToRestaurant(int id) {
-  double startTime = sh->fSt.startTime[id] + normalRand(STARTDEV);
+  double startTime = sh->fSt.startTime[id] + normalRand(STARTDEV) -
+                     (double)(nowUSec() - sh->openedAt);
 
   if (startTime > 0.0) {
     usleep((unsigned int)startTime);
@@ -158,12 +194,13 @@ static void goToRestaurant(int id) {
 /**
  *  \brief group eats
  *
- *  The group takes his time to eat a pleasant dinner.
+ *  The group takes his time to eat a pleasant dinner, one course at a time.
  *
  *  \param id group id
  */
 static void eat(int id) {
-  double eatTime = sh->fSt.eatTime[id] + normalRand(EATDEV);
+  double eatTime =
+      (double)sh->fSt.eatTime[id] / sh->fSt.courses + normalRand(EATDEV);
 
   if (eatTime > 0.0) {
     usleep((unsigned int)eatTime);
@@ -176,17 +213,39 @@ static void eat(int id) {
  *  Group should, as soon as receptionist is available, ask for a table,
  *  signaling receptionist of the request.
  *  Group may have to wait for a table in this method.
+ *  A group that finds more groups waiting than it tolerates leaves at once
+ *  (balks); one that runs out of patience while waiting gives up (reneges).
  *  The internal state should be saved.
  *
  *  \param id group id
  *
- *  \return true if first group, false otherwise
+ *  \return true if the group got a table, false if it leaves
  */
-static void checkInAtReception(int group_id) {
+static bool checkInAtReception(int group_id) {
+  // First the group looks at the queue for tables, if it minds it
+  if (sh->fSt.tolerance[group_id] >= 0) {
+    if (semDownWatched(semgid, sh->mutex) == -1) { /* enter critical region */
+      perror("error on the down operation for semaphore access (CT)");
+      exit(EXIT_FAILURE);
+    }
+    bool balk = sh->fSt.groupsWaiting > sh->fSt.tolerance[group_id];
+    if (balk) {
+      sh->fSt.st.groupStat[group_id] = LEAVING;
+      saveState(nFic, &sh->fSt);
+      sh->balked++;
+    }
+    if (semUp(semgid, sh->mutex) == -1) { /* exit critical region */
+      perror("error on the up operation for semaphore access (CT)");
+      exit(EXIT_FAILURE);
+    }
+    if (balk)
+      return false;
+  }
+
   // Before this group can do anything, we need to check if he can
   // make a request to the receptionist
 
-  if (semDown(semgid, sh->receptionistRequestPossible) == -1) {
+  if (semDownWatched(semgid, sh->receptionistRequestPossible) == -1) {
     perror("error on the down operation for semaphore access (CT)");
     exit(EXIT_FAILURE);
   }
@@ -194,7 +253,7 @@ static void checkInAtReception(int group_id) {
   // formulate the request
   request req;
 
-  if (semDown(semgid, sh->mutex) == -1) { /* enter critical region */
+  if (semDownWatched(semgid, sh->mutex) == -1) { /* enter critical region */
     perror("error on the down operation for semaphore access (CT)");
     exit(EXIT_FAILURE);
   }
@@ -211,6 +270,71 @@ static void checkInAtReception(int group_id) {
   sh->fSt.receptionistRequest = req;
 
   // We also have to signal him that the request data is now available
+  unsigned long long requestTime = nowUSec();
+
+  if (semUp(semgid, sh->receptionistReq) == -1) {
+    perror("error on the up operation for semaphore access (CT)");
+    exit(EXIT_FAILURE);
+  }
+
+  if (semUp(semgid, sh->mutex) == -1) { /* exit critical region */
+    perror("error on the up operation for semaphore access (CT)");
+    exit(EXIT_FAILURE);
+  }
+
+  // Now we have to wait for a table to be assigned to the group, as long as
+  // our patience lasts
+  if (sh->fSt.patience[group_id] == 0) {
+    if (semDownWatched(semgid, sh->waitForTable[group_id]) == -1) {
+      perror("error on the down operation for semaphore access (CT)");
+      exit(EXIT_FAILURE);
+    }
+  } else if (semDownTimed(semgid, sh->waitForTable[group_id],
+                          (unsigned int)sh->fSt.patience[group_id]) == -1) {
+    if (errno != EAGAIN) {
+      perror("error on the down operation for semaphore access (CT)");
+      exit(EXIT_FAILURE);
+    }
+    if (!renege(group_id)) {
+      latAdd(&sh->renegeWait, nowUSec() - requestTime);
+      return false;
+    }
+  }
+  unsigned long long wait = nowUSec() - requestTime;
+  latAdd(&sh->latency[LAT_CHECKIN], wait);
+  latAdd(&sh->sizeWait[sh->fSt.groupSize[group_id]], wait);
+  latAdd(&sh->bookingWait[sh->fSt.resvFrom[group_id] >= 0], wait);
+  return true;
+}
+
+/**
+ *  \brief group gives up waiting for a table.
+ *
+ *  The group asks the receptionist to take it off the groups waiting for a
+ *  table and waits for the answer. It may have been seated in the meantime, in
+ *  which case it stays.
+ *  The internal state should be saved.
+ *
+ *  \param id group id
+ *
+ *  \return true if the group got a table after all, false if it leaves
+ */
+static bool renege(int group_id) {
+  request req;
+
+  if (semDownWatched(semgid, sh->receptionistRequestPossible) == -1) {
+    perror("error on the down operation for semaphore access (CT)");
+    exit(EXIT_FAILURE);
+  }
+
+  if (semDownWatched(semgid, sh->mutex) == -1) { /* enter critical region */
+    perror("error on the down operation for semaphore access (CT)");
+    exit(EXIT_FAILURE);
+  }
+
+  req.reqType = RENEGEREQ;
+  req.reqGroup = group_id;
+  sh->fSt.receptionistRequest = req;
 
   if (semUp(semgid, sh->receptionistReq) == -1) {
     perror("error on the up operation for semaphore access (CT)");
@@ -222,28 +346,53 @@ static void checkInAtReception(int group_id) {
     exit(EXIT_FAILURE);
   }
 
-  // Now we have to wait for a table to be assigned to the group
-  if (semDown(semgid, sh->waitForTable[group_id]) == -1) {
+  // Either way, the receptionist answers through the table semaphore
+  if (semDownWatched(semgid, sh->waitForTable[group_id]) == -1) {
+    perror("error on the down operation for semaphore access (CT)");
+    exit(EXIT_FAILURE);
+  }
+
+  if (semDownWatched(semgid, sh->mutex) == -1) { /* enter critical region */
     perror("error on the down operation for semaphore access (CT)");
     exit(EXIT_FAILURE);
   }
+
+  bool seated = sh->fSt.assignedTable[group_id] != -1;
+  if (!seated) {
+    sh->fSt.st.groupStat[group_id] = LEAVING;
+    saveState(nFic, &sh->fSt);
+  }
+
+  if (semUp(semgid, sh->mutex) == -1) { /* exit critical region */
+    perror("error on the up operation for semaphore access (CT)");
+    exit(EXIT_FAILURE);
+  }
+
+  return seated;
 }
 
 /**
  *  \brief group orders food.
  *
- *  The group should update its state, request food to the waiter and
- *  wait for the waiter to receive the request.
+ *  The group should update its state, request food to the waiter of the zone
+ *  of its table and wait for the waiter to receive the request. Each course
+ *  is the dish on the menu after that of the previous one.
  *
  *  The internal state should be saved.
  *
  *  \param id group id
+ *  \param course course being ordered (0 for the first one)
  */
-static void orderFood(int group_id) {
+static void orderFood(int group_id, unsigned int course) {
+  // Our table does not change while we are seated, and its zone tells which
+  // waiter serves us
+  int zone = sh->fSt.tableZone[sh->fSt.assignedTable[group_id]];
+
   // Before we can do anything, we need to check whether or not the waiter is
-  // available to take a request
+  // available to take a request (the event front end queues requests instead)
 
-  if (semDown(semgid, sh->waiterRequestPossible) == -1) {
+  if (!sh->fSt.waiterEvents &&
+      semDownWatched(semgid, sh->waiterRequestPossible[zone]) == -1) {
     perror("error on the down operation for semaphore access (CT)");
     exit(EXIT_FAILURE);
   }
@@ -251,7 +400,7 @@ static void orderFood(int group_id) {
   // If the waiter is available, we can formulate a request
   request req;
 
-  if (semDown(semgid, sh->mutex) == -1) { /* enter critical region */
+  if (semDownWatched(semgid, sh->mutex) == -1) { /* enter critical region */
     perror("error on the down operation for semaphore access (CT)");
     exit(EXIT_FAILURE);
   }
@@ -260,12 +409,22 @@ static void orderFood(int group_id) {
   // to formulate the request
   req.reqGroup = group_id;
   req.reqType = FOODREQ;
+  req.reqDish = (int)(((unsigned int)sh->fSt.firstDish[group_id] + course) %
+                      sh->fSt.nDishes);
 
   // After that, we can signal to the waiter that he has a request
-  sh->fSt.waiterRequest = req;
-  if (semUp(semgid, sh->waiterRequest) == -1) { /* exit critical region */
-    perror("error on the up operation for semaphore access (CT)");
-    exit(EXIT_FAILURE);
+  foodRequestTime = nowUSec();
+  if (sh->fSt.waiterEvents) {
+    if (!rqPush(&sh->fSt.foodReqQueue[zone], req)) {
+      fprintf(stderr, "food request queue is full (CT)\n");
+      exit(EXIT_FAILURE);
+    }
+  } else {
+    sh->fSt.waiterRequest[zone] = req;
+    if (semUp(semgid, sh->waiterRequest[zone]) == -1) {
+      perror("error on the up operation for semaphore access (CT)");
+      exit(EXIT_FAILURE);
+    }
   }
   // Only when the waiter is available to make a request can we change
   // our state
@@ -280,11 +439,17 @@ static void orderFood(int group_id) {
     exit(EXIT_FAILURE);
   }
 
+  if (sh->fSt.waiterEvents && rqNotify(sh->foodReqEvent[zone]) == -1) {
+    perror("error on the notification of the waiter (CT)");
+    exit(EXIT_FAILURE);
+  }
+
   // Now we wait for the waiter to get the request
-  if (semDown(semgid, sh->requestReceived[table_id]) == -1) {
+  if (semDownWatched(semgid, sh->requestReceived[table_id]) == -1) {
     perror("error on the down operation for semaphore access (CT)");
     exit(EXIT_FAILURE);
   }
+  latAdd(&sh->latency[LAT_FOODACK], nowUSec() - foodRequestTime);
 }
 
 /**
@@ -297,7 +462,7 @@ static void orderFood(int group_id) {
  *  \param id group id
  */
 static void waitFood(int group_id) {
-  if (semDown(semgid, sh->mutex) == -1) { /* enter critical region */
+  if (semDownWatched(semgid, sh->mutex) == -1) { /* enter critical region */
     perror("error on the down operation for semaphore access (CT)");
     exit(EXIT_FAILURE);
   }
@@ -316,12 +481,13 @@ static void waitFood(int group_id) {
 
   // First we have to check if the food has arrived
 
-  if (semDown(semgid, sh->foodArrived[table_id]) == -1) {
+  if (semDownWatched(semgid, sh->foodArrived[table_id]) == -1) {
     perror("error on the down operation for semaphore access (CT)");
     exit(EXIT_FAILURE);
   }
+  latAdd(&sh->latency[LAT_FOOD], nowUSec() - foodRequestTime);
 
-  if (semDown(semgid, sh->mutex) == -1) { /* enter critical region */
+  if (semDownWatched(semgid, sh->mutex) == -1) { /* enter critical region */
     perror("error on the down operation for semaphore access (CT)");
     exit(EXIT_FAILURE);
   }
@@ -346,15 +512,33 @@ static void waitFood(int group_id) {
  *  Group waits for receptionist to acknowledge payment.
  *  Group should update its state to LEAVING, after acknowledge.
  *  The internal state should be saved twice.
+ *  With table-side checkout, the group instead marks itself gone with a single
+ *  atomic operation and notifies the receptionists, without waiting for the
+ *  request slot nor for an acknowledge: the receptionist that takes the notice
+ *  frees its tables and updates its state. Only the checkout is lock-free, the
+ *  release of the tables is deferred to the receptionist, as the free lists and
+ *  the seating of the groups waiting for them are kept within the critical
+ *  region.
  *
  *  \param id group id
  */
 static void checkOutAtReception(int group_id) {
 
+  if (sh->fSt.selfCheckout) {
+    sh->leftAt[group_id] = nowUSec();
+    __atomic_fetch_or(&sh->checkedOut, 1U << group_id, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&sh->checkoutNotes, 1, __ATOMIC_RELEASE);
+    if (semUp(semgid, sh->receptionistReq) == -1) {
+      perror("error on the up operation for semaphore access (CT)");
+      exit(EXIT_FAILURE);
+    }
+    return;
+  }
+
   // To checkout, we need to check whether or not the receptionist is available
   // to receive a request
 
-  if (semDown(semgid, sh->receptionistRequestPossible) == -1) {
+  if (semDownWatched(semgid, sh->receptionistRequestPossible) == -1) {
     perror("error on the down operation for semaphore access (CT)");
     exit(EXIT_FAILURE);
   }
@@ -362,7 +546,7 @@ static void checkOutAtReception(int group_id) {
   // If the receptionist is available, we can formulate the request
   request req;
 
-  if (semDown(semgid, sh->mutex) == -1) { /* enter critical region */
+  if (semDownWatched(semgid, sh->mutex) == -1) { /* enter critical region */
     perror("error on the down operation for semaphore access (CT)");
     exit(EXIT_FAILURE);
   }
@@ -380,6 +564,7 @@ static void checkOutAtReception(int group_id) {
 
   // Then we give the request to the receptionist, signaling him
   sh->fSt.receptionistRequest = req;
+  unsigned long long requestTime = nowUSec();
   if (semUp(semgid, sh->receptionistReq) == -1) {
     perror("error on the down operation for semaphore access (CT)");
     exit(EXIT_FAILURE);
@@ -391,12 +576,13 @@ static void checkOutAtReception(int group_id) {
   }
 
   // Now we wait for the receptionist to process the payment
-  if (semDown(semgid, sh->tableDone[table_id]) == -1) {
+  if (semDownWatched(semgid, sh->tableDone[table_id]) == -1) {
     perror("error on the down operation for semaphore access (CT)");
     exit(EXIT_FAILURE);
   }
+  latAdd(&sh->latency[LAT_CHECKOUT], nowUSec() - requestTime);
 
-  if (semDown(semgid, sh->mutex) == -1) { /* enter critical region */
+  if (semDownWatched(semgid, sh->mutex) == -1) { /* enter critical region */
     perror("error on the down operation for semaphore access (CT)");
     exit(EXIT_FAILURE);
   }
@@ -10,11 +10,18 @@
  *     \li waitForGroup
  *     \li provideTableOrWaitingRoom
  *     \li receivePayment
+ *     \li removeFromWaitingRoom
+ *     \li receiveCheckouts
+ *
+ *  Several receptionists may share the reception: each one takes the next
+ *  request from the slot and handles it on the seating state kept in the
+ *  shared region, within the critical region.
  *
  *  \author Nuno Lau - December 2023
  */
 
 #include <assert.h>
+#include <errno.h>
 #include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -29,6 +36,9 @@
 #include "semaphore.h"
 #include "sharedDataSync.h"
 #include "sharedMemory.h"
+#include "watchdog.h"
+#include "perfCounters.h"
+#include "metrics.h"
 
 /** \brief logging file name */
 static char nFic[51];
@@ -42,15 +52,23 @@ static int semgid;
 /** \brief pointer to shared memory region */
 static SHARED_DATA *sh;
 
+/** \brief entity id of this receptionist */
+static unsigned int self;
+
+/** \brief number of requests handled by this receptionist */
+static unsigned long handled;
+
 /* constants for groupRecord */
 #define TOARRIVE 0
 #define WAIT 1
 #define ATTABLE 2
 #define DONE 3
 
-/** \brief receptioninst view on each group evolution (useful to decide table
- * binding) */
-static int groupRecord[MAXGROUPS];
+/* constants for resvRecord */
+#define WALKIN 0
+#define BOOKED 1
+#define HELD 2
+#define HONORED 3
 
 /** \brief receptionist waits for next request */
 static request waitForGroup();
@@ -61,6 +79,30 @@ static void provideTableOrWaitingRoom(int n);
 /** \brief receptionist receives payment */
 static void receivePayment(int n);
 
+/** \brief receptionist lets a waiting group go */
+static void removeFromWaitingRoom(int n);
+
+/** \brief receptionist frees the tables of the groups that checked out at them */
+static void receiveCheckouts();
+
+/** \brief tables of the groups that checked out at them are freed */
+static void collectCheckouts();
+
+/** \brief tables become free */
+static void releaseTables(unsigned int set);
+
+/** \brief seating state is set up, by the first receptionist */
+static void initSeating();
+
+/** \brief reservations take and drop their tables */
+static void updateHolds(unsigned long long now);
+
+/** \brief time at which the next reservation is to be held or dropped */
+static unsigned long long nextHoldEvent(unsigned long long now);
+
+/** \brief waiting groups are seated, while they fit */
+static void seatWaitingGroups();
+
 /**
  *  \brief Main program.
  *
@@ -70,9 +112,10 @@ static void receivePayment(int n);
 int main(int argc, char *argv[]) {
   int key;    /*access key to shared memory and semaphore set */
   char *tinp; /* numerical parameters test flag */
+  int k;      /* number of the receptionist */
 
   /* validation of command line parameters */
-  if (argc != 4) {
+  if (argc != 5) {
     freopen("error_RT", "a", stderr);
     fprintf(stderr, "Number of parameters is incorrect!\n");
     return EXIT_FAILURE;
@@ -87,6 +130,12 @@ int main(int argc, char *argv[]) {
     fprintf(stderr, "Error on the access key communication!\n");
     return EXIT_FAILURE;
   }
+  k = (int)strtol(argv[4], &tinp, 0);
+  if ((*tinp != '\0') || (k < 0) || (k >= MAXRECEPTIONISTS)) {
+    fprintf(stderr, "Receptionist number is out of range!\n");
+    return EXIT_FAILURE;
+  }
+  self = (k == 0) ? RECEPTIONIST_ID : RECEPTIONISTS_ID + (unsigned int)(k - 1);
 
   /* connection to the semaphore set and the shared memory region and mapping
      the shared region onto the process address space */
@@ -103,20 +152,40 @@ int main(int argc, char *argv[]) {
     return EXIT_FAILURE;
   }
 
+  /* register entity for stall detection */
+  watchdogInit(sh, self);
+
+  /* spin-then-block waiting, if requested */
+  if (sh->fSt.spinMax > 0) {
+    semSpinEnable(sh->semShadow, sh->fSt.spinMax);
+  }
+
   /* initialize random generator */
   srandom((unsigned int)getpid());
 
-  /* initialize internal receptionist memory */
-  int g;
-  for (g = 0; g < sh->fSt.nGroups; g++) {
-    groupRecord[g] = TOARRIVE;
+  /* set up the seating state, unless another receptionist did */
+  if (semDownWatched(semgid, sh->mutex) == -1) { /* enter critical region */
+    perror("error on the up operation for semaphore access (RT)");
+    exit(EXIT_FAILURE);
+  }
+  if (!sh->seatingReady)
+    initSeating();
+  if (semUp(semgid, sh->mutex) == -1) { /* exit critical region */
+    perror("error on the down operation for semaphore access (RT)");
+    exit(EXIT_FAILURE);
+  }
+
+  /* start counting hardware events, if requested */
+  if (sh->fSt.perfCounters) {
+    perfStart();
   }
 
+  /* start busy/idle accounting */
+  utilStart(&sh->util[self]);
+
   /* simulation of the life cycle of the receptionist */
-  int nReq = 0;
   request req;
-  while (nReq < sh->fSt.nGroups * 2) {
-    req = waitForGroup();
+  while ((req = waitForGroup()).reqType != NOREQ) {
     switch (req.reqType) {
     case TABLEREQ:
       provideTableOrWaitingRoom(req.reqGroup);
@@ -124,8 +193,23 @@ int main(int argc, char *argv[]) {
     case BILLREQ:
       receivePayment(req.reqGroup);
       break;
+    case RENEGEREQ:
+      removeFromWaitingRoom(req.reqGroup);
+      break;
+    case CHECKOUTNOTE:
+      receiveCheckouts();
+      break;
     }
-    nReq++;
+    handled++;
+  }
+
+  /* publishing accounting data */
+  utilStop(&sh->util[self]);
+  sh->receptions[k] = handled;
+  sh->semOps[self] = semOpCount();
+  semSpinStats(&sh->spinHits[self], &sh->spinMisses[self]);
+  if (sh->fSt.perfCounters) {
+    perfStop(sh->perfCount[self]);
   }
 
   /* unmapping the shared region off the process address space */
@@ -139,29 +223,260 @@ int main(int argc, char *argv[]) {
   return EXIT_SUCCESS;
 }
 
+/**
+ *  \brief seating state is set up, by the first receptionist.
+ *
+ *  Groups are yet to arrive, reservations are booked and every table is free.
+ *  Called within the critical region.
+ */
+static void initSeating() {
+  for (int g = 0; g < sh->fSt.nGroups; g++) {
+    sh->groupRecord[g] = TOARRIVE;
+    sh->resvRecord[g] = (sh->fSt.resvFrom[g] < 0) ? WALKIN : BOOKED;
+  }
+  for (int c = 0; c <= MAXSEATS; c++)
+    sh->freeTables[c] = -1;
+  sh->freeMask = 0;
+  releaseTables((sh->fSt.nTables < MAXTABLES) ? (1U << sh->fSt.nTables) - 1
+                                              : ~0U);
+  sh->seatingReady = true;
+}
+
+/**
+ *  \brief tables become free.
+ *
+ *  Each table is put back at the head of the free list of its capacity, the
+ *  highest id first, so that equal tables are taken in id order.
+ *
+ *  \param set tables (one bit per table)
+ */
+static void releaseTables(unsigned int set) {
+  for (int table = sh->fSt.nTables - 1; table >= 0; table--)
+    if (set & (1U << table)) {
+      int seats = sh->fSt.tableSeats[table];
+      sh->nextFree[table] = sh->freeTables[seats];
+      sh->prevFree[table] = -1;
+      if (sh->freeTables[seats] != -1)
+        sh->prevFree[sh->freeTables[seats]] = table;
+      sh->freeTables[seats] = table;
+      sh->freeMask |= 1U << table;
+    }
+}
+
+/**
+ *  \brief tables are taken off their free lists.
+ *
+ *  \param set tables (one bit per table)
+ */
+static void takeTables(unsigned int set) {
+  for (int table = 0; table < sh->fSt.nTables; table++)
+    if (set & (1U << table)) {
+      if (sh->prevFree[table] != -1)
+        sh->nextFree[sh->prevFree[table]] = sh->nextFree[table];
+      else
+        sh->freeTables[sh->fSt.tableSeats[table]] = sh->nextFree[table];
+      if (sh->nextFree[table] != -1)
+        sh->prevFree[sh->nextFree[table]] = sh->prevFree[table];
+      sh->freeMask &= ~(1U << table);
+    }
+}
+
+/**
+ *  \brief finds the free tables that best fit a group.
+ *
+ *  The free lists are visited from the size of the group up, so a single
+ *  table is the smallest one the group fits in. If no table is large enough,
+ *  adjacent free tables are pushed together: starting from each free table,
+ *  the largest free neighbour of the row is added until the group fits, and
+ *  the row with fewest seats (then fewest tables) is chosen.
+ *
+ *  \param size number of people of the group
+ *
+ *  \return tables (one bit per table, 0 if the group does not fit)
+ */
+static unsigned int bestFit(int size) {
+  unsigned int best = 0, row, edge;
+  int bestSeats = 0, seats, add;
+
+  for (seats = size; seats <= MAXSEATS; seats++)
+    if (sh->freeTables[seats] != -1)
+      return 1U << sh->freeTables[seats];
+
+  for (int table = 0; table < sh->fSt.nTables; table++) {
+    if (!(sh->freeMask & (1U << table)))
+      continue;
+    row = 1U << table;
+    seats = sh->fSt.tableSeats[table];
+    for (edge = sh->fSt.adjacent[table] & sh->freeMask & ~row;
+         (seats < size) && (edge != 0);) {
+      add = -1;
+      for (int t = 0; t < sh->fSt.nTables; t++)
+        if ((edge & (1U << t)) &&
+            ((add == -1) || (sh->fSt.tableSeats[t] > sh->fSt.tableSeats[add])))
+          add = t;
+      row |= 1U << add;
+      seats += sh->fSt.tableSeats[add];
+      edge = (edge | sh->fSt.adjacent[add]) & sh->freeMask & ~row;
+    }
+    if ((seats >= size) &&
+        ((best == 0) || (seats < bestSeats) ||
+         ((seats == bestSeats) &&
+          (__builtin_popcount(row) < __builtin_popcount(best))))) {
+      best = row;
+      bestSeats = seats;
+    }
+  }
+  return best;
+}
+
+/**
+ *  \brief tables are held for a reservation, if they are free.
+ *
+ *  A reservation by table needs that table; one by size takes the tables that
+ *  best fit the seats booked.
+ *
+ *  \param group_id group id
+ *  \param now current time
+ */
+static void holdTables(int group_id, unsigned long long now) {
+  int table = sh->fSt.resvTable[group_id];
+  unsigned int set = (table >= 0) ? sh->freeMask & (1U << table)
+                                  : bestFit(sh->fSt.resvSeats[group_id]);
+  if (set == 0)
+    return;
+  takeTables(set);
+  sh->heldSet[group_id] = set;
+  sh->heldSince[group_id] = now;
+  sh->resvRecord[group_id] = HELD;
+}
+
+/**
+ *  \brief reservations take and drop their tables.
+ *
+ *  A reservation whose group has not arrived by the end of its arrival window
+ *  plus the grace time is dropped (the group will walk in), releasing its
+ *  tables. A reservation whose group is waiting or whose window starts within
+ *  the lead time holds its tables as soon as they are free; once the group is
+ *  seated or gone, nothing is held for it.
+ *
+ *  \param now current time
+ */
+static void updateHolds(unsigned long long now) {
+  unsigned long long drop;
+
+  for (int group_id = 0; group_id < sh->fSt.nGroups; group_id++) {
+    if ((sh->resvRecord[group_id] != BOOKED) && (sh->resvRecord[group_id] != HELD))
+      continue;
+    drop = sh->openedAt + (unsigned long long)sh->fSt.resvUntil[group_id] +
+           sh->fSt.holdGrace;
+    if ((sh->groupRecord[group_id] == TOARRIVE) && (now > drop)) {
+      if (sh->resvRecord[group_id] == HELD) {
+        releaseTables(sh->heldSet[group_id]);
+        sh->heldIdle += (drop - sh->heldSince[group_id]) *
+                        (unsigned long long)__builtin_popcount(sh->heldSet[group_id]);
+      }
+      sh->resvRecord[group_id] = WALKIN;
+      sh->dropped++;
+    } else if ((sh->resvRecord[group_id] == BOOKED) &&
+               ((sh->groupRecord[group_id] == WAIT) ||
+                ((sh->groupRecord[group_id] == TOARRIVE) &&
+                 (now + sh->fSt.holdLead >=
+                  sh->openedAt + (unsigned long long)sh->fSt.resvFrom[group_id]))))
+      holdTables(group_id, now);
+  }
+}
+
+/**
+ *  \brief time at which the next reservation is to be held or dropped.
+ *
+ *  A booked reservation is held from the lead time before its arrival window,
+ *  so that the time its tables stay empty is accounted from then on; one
+ *  whose lead time is past holds its tables when they are freed. A held one is
+ *  dropped past its window plus the grace time, which only matters while
+ *  groups wait for the tables.
+ *
+ *  \param now current time
+ *
+ *  \return time of the event or 0 (if there is none to come)
+ */
+static unsigned long long nextHoldEvent(unsigned long long now) {
+  unsigned long long next = 0, at, from;
+
+  for (int group_id = 0; group_id < sh->fSt.nGroups; group_id++) {
+    if (sh->groupRecord[group_id] != TOARRIVE)
+      continue;
+    from = sh->openedAt + (unsigned long long)sh->fSt.resvFrom[group_id];
+    if ((sh->resvRecord[group_id] == HELD) && (sh->fSt.groupsWaiting > 0))
+      at = sh->openedAt + (unsigned long long)sh->fSt.resvUntil[group_id] +
+           sh->fSt.holdGrace + 1;
+    else if ((sh->resvRecord[group_id] == BOOKED) &&
+             (from > now + sh->fSt.holdLead))
+      at = from - sh->fSt.holdLead;
+    else
+      continue;
+    if ((next == 0) || (at < next))
+      next = at;
+  }
+  return next;
+}
+
 /**
  *  \brief decides table to occupy for group n or if it must wait.
  *
  *  Checks current state of tables and groups in order to decide table or wait.
+ *  A group whose tables are held takes them; otherwise the tables chosen are
+ *  taken off their free lists. They are recorded as the set of the group; the
+ *  first one is where the group is served.
  *
  *  \return table id or -1 (in case of wait decision)
  */
 static int decideTableOrWait(int group_id) {
-  assert(groupRecord[group_id] <
+  assert(sh->groupRecord[group_id] <
          2); // We need to check if the group hasnt already been seated, which
              // means if they are arriving or waiting;
-  int group;
-  for (int table = 0; table < NUMTABLES; table++) {
-    for (group = 0; group < sh->fSt.nGroups; group++) {
-      if (sh->fSt.assignedTable[group] == table) {
-        break;
-      }
+  unsigned int set;
+  if (sh->resvRecord[group_id] == HELD) {
+    set = sh->heldSet[group_id];
+    sh->resvRecord[group_id] = HONORED;
+    sh->honored++;
+    sh->heldIdle += (nowUSec() - sh->heldSince[group_id]) *
+                    (unsigned long long)__builtin_popcount(set);
+  } else if ((set = bestFit(sh->fSt.groupSize[group_id])) != 0) {
+    takeTables(set);
+    // A group seated before its tables were held has its reservation honored
+    // all the same, and nothing is to be held for it any longer
+    if (sh->resvRecord[group_id] == BOOKED) {
+      sh->resvRecord[group_id] = HONORED;
+      sh->honored++;
     }
-    if (group != sh->fSt.nGroups)
-      continue;
-    return table;
-  }
-  return -1;
+  } else
+    return -1;
+  sh->fSt.tableSet[group_id] = set;
+  if (__builtin_popcount(set) > 1)
+    sh->combined++;
+  return __builtin_ctz(set);
+}
+
+/**
+ *  \brief counts the tables that have a group assigned.
+ *
+ *  \return number of occupied tables
+ */
+static int occupiedTables() {
+  return sh->fSt.nTables - __builtin_popcount(sh->freeMask);
+}
+
+/**
+ *  \brief counts the seats taken by the groups at a table.
+ *
+ *  \return number of occupied seats
+ */
+static int occupiedSeats() {
+  int n = 0;
+  for (int group = 0; group < sh->fSt.nGroups; group++)
+    if (sh->fSt.assignedTable[group] != -1)
+      n += sh->fSt.groupSize[group];
+  return n;
 }
 
 /**
@@ -169,6 +484,7 @@ static int decideTableOrWait(int group_id) {
  *         to decide which group (if any) should occupy it.
  *
  *  Checks current state of tables and groups in order to decide group.
+ *  Groups whose tables are held for them have precedence over walk-ins.
  *
  *  \return group id or -1 (in case of wait decision)
  */
@@ -177,29 +493,62 @@ static int decideNextGroup() {
   if (sh->fSt.groupsWaiting <= 0)
     return -1;
 
-  // If there are groups waiting, we need to select one to have the table;
+  // Groups whose tables are held for them go first
+  for (int group_id = 0; group_id < sh->fSt.nGroups; group_id++) {
+    if ((sh->groupRecord[group_id] == WAIT) && (sh->resvRecord[group_id] == HELD)) {
+      return group_id;
+    }
+  }
+
+  // Then we need to select one that fits a free table;
   for (int group_id = 0; group_id < sh->fSt.nGroups; group_id++) {
-    if (groupRecord[group_id] == WAIT) {
+    if ((sh->groupRecord[group_id] == WAIT) &&
+        (bestFit(sh->fSt.groupSize[group_id]) != 0)) {
       return group_id;
     }
   }
   return -1;
 }
 
+/**
+ *  \brief waiting groups are seated, while they fit.
+ *
+ *  Called within the critical region when tables become free.
+ */
+static void seatWaitingGroups() {
+  while (sh->fSt.groupsWaiting > 0) {
+    int new_group_id = decideNextGroup();
+    if (new_group_id == -1)
+      break;
+    sh->fSt.assignedTable[new_group_id] = decideTableOrWait(new_group_id);
+    sh->groupRecord[new_group_id] = ATTABLE;
+    if (semUp(semgid, sh->waitForTable[new_group_id]) == -1) {
+      perror("error on the down operation for semaphore access (RT)");
+      exit(EXIT_FAILURE);
+    }
+    sh->fSt.groupsWaiting--;
+  }
+  avgSet(&sh->waitingAvg, sh->fSt.groupsWaiting);
+  avgSet(&sh->occupancyAvg, occupiedTables());
+  avgSet(&sh->seatsAvg, occupiedSeats());
+}
+
 /**
  *  \brief receptionist waits for next request
  *
  *  Receptionist updates state and waits for request from group, then reads
  * request, and signals availability for new request. The internal state should
- * be saved.
+ * be saved. The receptionist also wakes up when the next reservation is to
+ * hold its tables, and, while groups wait, when the next one held is dropped,
+ * to seat them.
  *
- *  \return request submitted by group
+ *  \return request submitted by group (NOREQ once the restaurant is closing)
  */
 static request waitForGroup() {
   request ret;
 
   fprintf(stderr, "Entered critical region at waitForGroup(1)\n");
-  if (semDown(semgid, sh->mutex) == -1) { /* enter critical region */
+  if (semDownWatched(semgid, sh->mutex) == -1) { /* enter critical region */
     perror("error on the up operation for semaphore access (RT)");
     exit(EXIT_FAILURE);
   }
@@ -208,6 +557,8 @@ static request waitForGroup() {
   // (up semaphore); then leave the critical region;
   sh->fSt.st.receptionistStat = WAIT_FOR_REQUEST;
   saveState(nFic, &sh->fSt);
+  utilBusy(&sh->util[self], false);
+  unsigned long long wake = nextHoldEvent(nowUSec()), now;
 
   if (semUp(semgid, sh->mutex) == -1) { /* exit critical region */
     perror("error on the down operation for semaphore access (RT)");
@@ -215,22 +566,58 @@ static request waitForGroup() {
   }
   fprintf(stderr, "Exited critical region at waitForGroup(1)\n");
 
-  // Wait for any requests to the waiter
-  if (semDown(semgid, sh->receptionistReq) == -1) {
-    perror("error on the up operation for semaphore access (RT)");
-    exit(EXIT_FAILURE);
+  // Wait for any requests to the waiter, but not past the next reservation
+  // held or dropped
+  while (true) {
+    if (wake == 0) {
+      if (semDownWatched(semgid, sh->receptionistReq) == -1) {
+        perror("error on the up operation for semaphore access (RT)");
+        exit(EXIT_FAILURE);
+      }
+      break;
+    }
+    now = nowUSec();
+    if (semDownTimed(semgid, sh->receptionistReq,
+                     (now < wake) ? (unsigned int)(wake - now) : 0) == 0)
+      break;
+    if (errno != EAGAIN) {
+      perror("error on the down operation for semaphore access (RT)");
+      exit(EXIT_FAILURE);
+    }
+    if (semDownWatched(semgid, sh->mutex) == -1) { /* enter critical region */
+      perror("error on the up operation for semaphore access (RT)");
+      exit(EXIT_FAILURE);
+    }
+    updateHolds(nowUSec());
+    seatWaitingGroups();
+    saveState(nFic, &sh->fSt);
+    wake = nextHoldEvent(nowUSec());
+    if (semUp(semgid, sh->mutex) == -1) { /* exit critical region */
+      perror("error on the down operation for semaphore access (RT)");
+      exit(EXIT_FAILURE);
+    }
   }
 
   fprintf(stderr, "Entered critical region at waitForGroup(2)\n");
-  if (semDown(semgid, sh->mutex) == -1) { /* enter
+  if (semDownWatched(semgid, sh->mutex) == -1) { /* enter
                                              critical
                                              region */
     perror("error on the up operation for semaphore access (RT)");
     exit(EXIT_FAILURE);
   }
 
-  // Formulate the request;
-  ret = sh->fSt.receptionistRequest;
+  // Formulate the request: table-side checkouts notify without the slot, and
+  // only receptionists take their notices, within the critical region (once
+  // every group has left, the wakeup can only come from the generator closing
+  // the restaurant);
+  if (__atomic_load_n(&sh->checkoutNotes, __ATOMIC_ACQUIRE) > 0) {
+    __atomic_fetch_sub(&sh->checkoutNotes, 1, __ATOMIC_ACQ_REL);
+    ret.reqType = CHECKOUTNOTE;
+    ret.reqGroup = -1;
+  } else if (sh->closing)
+    ret.reqType = NOREQ;
+  else
+    ret = sh->fSt.receptionistRequest;
 
   if (semUp(semgid, sh->mutex) == -1) { /* exit critical region */
     perror("error on the down operation for semaphore access (RT)");
@@ -238,7 +625,8 @@ static request waitForGroup() {
   }
 
   fprintf(stderr, "Exited critical region at waitForGroup(2)\n");
-  if (semUp(semgid, sh->receptionistRequestPossible) == -1) {
+  if ((ret.reqType != NOREQ) && (ret.reqType != CHECKOUTNOTE) &&
+      semUp(semgid, sh->receptionistRequestPossible) == -1) {
     perror("error on the down operation for semaphore access (RT)");
     exit(EXIT_FAILURE);
   }
@@ -250,14 +638,15 @@ static request waitForGroup() {
  *  \brief receptionist decides if group should occupy table or wait
  *
  *  Receptionist updates state and then decides if group occupies table
- *  or waits. Shared (and internal) memory may need to be updated.
+ *  or waits, honoring the tables held for its reservation.
+ *  Shared (and internal) memory may need to be updated.
  *  If group occupies table, it must be informed that it may proceed.
  *  The internal state should be saved.
  *
  */
 static void provideTableOrWaitingRoom(int group_id) {
 
-  if (semDown(semgid, sh->mutex) == -1) { /* enter critical region */
+  if (semDownWatched(semgid, sh->mutex) == -1) { /* enter critical region */
     perror("error on the up operation for semaphore access (RT)");
     exit(EXIT_FAILURE);
   }
@@ -265,23 +654,44 @@ static void provideTableOrWaitingRoom(int group_id) {
   // TODO insert your code here
   sh->fSt.st.receptionistStat = ASSIGNTABLE;
   saveState(nFic, &sh->fSt);
+  utilBusy(&sh->util[self], true);
+  // Another receptionist may have let the group go already
+  if (sh->groupRecord[group_id] == DONE) {
+    if (semUp(semgid, sh->mutex) == -1) { /* exit critical region */
+      perror("error on the down operation for semaphore access (RT)");
+      exit(EXIT_FAILURE);
+    }
+    return;
+  }
+  // Tables left at table-side checkouts are freed, reservations are brought up
+  // to date (the group holds its tables on arrival, if they are free) and
+  // those already waiting go first;
+  collectCheckouts();
+  unsigned long long now = nowUSec();
+  updateHolds(now);
+  if (sh->resvRecord[group_id] == BOOKED)
+    holdTables(group_id, now);
+  seatWaitingGroups();
   // See if a table is available for this group;
   int table_id = decideTableOrWait(group_id);
 
   // If no table is available, set the group to waiting;
   if (table_id < 0) {
     sh->fSt.groupsWaiting++;
-    groupRecord[group_id] = WAIT;
+    sh->groupRecord[group_id] = WAIT;
   }
   // Else, sit the group;
   else {
-    groupRecord[group_id] = ATTABLE;
+    sh->groupRecord[group_id] = ATTABLE;
     sh->fSt.assignedTable[group_id] = table_id;
     if (semUp(semgid, sh->waitForTable[group_id]) == -1) {
       perror("error on the down operation for semaphore access (RT)");
       exit(EXIT_FAILURE);
     }
   }
+  avgSet(&sh->waitingAvg, sh->fSt.groupsWaiting);
+  avgSet(&sh->occupancyAvg, occupiedTables());
+  avgSet(&sh->seatsAvg, occupiedSeats());
 
   if (semUp(semgid, sh->mutex) == -1) { /* exit critical region */
     perror("error on the down operation for semaphore access (RT)");
@@ -293,37 +703,85 @@ static void provideTableOrWaitingRoom(int group_id) {
  *  \brief receptionist receives payment
  *
  *  Receptionist updates its state and receives payment.
- *  If there are waiting groups, receptionist should check if table that just
- * became vacant should be occupied. Shared (and internal) memory should be
+ *  If there are waiting groups, receptionist should check if the tables that
+ * just became vacant should be occupied. Shared (and internal) memory should be
  * updated. The internal state should be saved.
  *
  */
 
 static void receivePayment(int group_id) {
   fprintf(stderr, "Entered critical region at receivePayment\n");
-  if (semDown(semgid, sh->mutex) == -1) { /* enter critical region */
+  if (semDownWatched(semgid, sh->mutex) == -1) { /* enter critical region */
     perror("error on the up operation for semaphore access (RT)");
     exit(EXIT_FAILURE);
   }
 
   sh->fSt.st.receptionistStat = RECVPAY;
   saveState(nFic, &sh->fSt);
-  groupRecord[group_id] = DONE;
+  utilBusy(&sh->util[self], true);
+  sh->groupRecord[group_id] = DONE;
   // If the group is paying, then the table is now vacant!
   int table_id = sh->fSt.assignedTable[group_id];
   sh->fSt.assignedTable[group_id] =
       -1; // Which means we need to define the table as empty!
-  // If there are groups waiting, then we can sit them at that table!
-  if (sh->fSt.groupsWaiting > 0) {
-    int new_group_id = decideNextGroup();
-    if (new_group_id > -1) {
-      groupRecord[new_group_id] = ATTABLE;
-      if (semUp(semgid, sh->waitForTable[new_group_id]) == -1) {
-        perror("error on the down operation for semaphore access (RT)");
-        exit(EXIT_FAILURE);
-      }
+  // Tables pushed together are released together, and reservations may
+  // hold them before anybody else
+  releaseTables(sh->fSt.tableSet[group_id]);
+  sh->fSt.tableSet[group_id] = 0;
+  collectCheckouts();
+  updateHolds(nowUSec());
+  // If there are groups waiting, then we can sit those that fit now!
+  seatWaitingGroups();
+
+  if (semUp(semgid, sh->mutex) == -1) { /* exit critical region */
+    perror("error on the down operation for semaphore access (RT)");
+    exit(EXIT_FAILURE);
+  }
+
+  if (semUp(semgid, sh->tableDone[table_id]) == -1) {
+    perror("error on the down operation for semaphore access (RT)");
+    exit(EXIT_FAILURE);
+  }
+}
+
+/**
+ *  \brief receptionist lets a waiting group go
+ *
+ *  The group ran out of patience. If it is still waiting, it is taken off the
+ *  waiting groups (and its reservation, if any, is dropped); if it was seated
+ *  meanwhile, it has already been told and stays. With several receptionists,
+ *  its table request may still be on its way through another one: the group
+ *  is let go at once and that request is then ignored. Either way the group ends up
+ *  with exactly one up on its table semaphore. The internal state should be
+ *  saved.
+ *
+ */
+static void removeFromWaitingRoom(int group_id) {
+  if (semDownWatched(semgid, sh->mutex) == -1) { /* enter critical region */
+    perror("error on the up operation for semaphore access (RT)");
+    exit(EXIT_FAILURE);
+  }
+
+  utilBusy(&sh->util[self], true);
+  if ((sh->groupRecord[group_id] == WAIT) ||
+      (sh->groupRecord[group_id] == TOARRIVE)) {
+    if (sh->groupRecord[group_id] == WAIT)
       sh->fSt.groupsWaiting--;
-      sh->fSt.assignedTable[new_group_id] = table_id;
+    sh->groupRecord[group_id] = DONE;
+    if (sh->resvRecord[group_id] == HELD) {
+      releaseTables(sh->heldSet[group_id]);
+      sh->heldIdle += (nowUSec() - sh->heldSince[group_id]) *
+                      (unsigned long long)__builtin_popcount(sh->heldSet[group_id]);
+    }
+    if (sh->resvRecord[group_id] != WALKIN) {
+      sh->resvRecord[group_id] = WALKIN;
+      sh->dropped++;
+    }
+    seatWaitingGroups();
+    saveState(nFic, &sh->fSt);
+    if (semUp(semgid, sh->waitForTable[group_id]) == -1) {
+      perror("error on the down operation for semaphore access (RT)");
+      exit(EXIT_FAILURE);
     }
   }
 
@@ -331,8 +789,55 @@ static void receivePayment(int group_id) {
     perror("error on the down operation for semaphore access (RT)");
     exit(EXIT_FAILURE);
   }
+}
 
-  if (semUp(semgid, sh->tableDone[table_id]) == -1) {
+/**
+ *  \brief tables of the groups that checked out at them are freed.
+ *
+ *  The groups marked themselves gone with an atomic operation and left; they
+ *  are taken all at once, so a notice may find the work already done by an
+ *  earlier one. Their check-out lasts until here, when the tables are back on
+ *  the free lists, as for a payment at the desk. Called within the critical
+ *  region.
+ */
+static void collectCheckouts() {
+  unsigned int gone = __atomic_exchange_n(&sh->checkedOut, 0, __ATOMIC_ACQUIRE);
+  unsigned long long now = nowUSec();
+
+  for (int group_id = 0; gone != 0; group_id++, gone >>= 1)
+    if (gone & 1U) {
+      latAdd(&sh->releaseLag, now - sh->leftAt[group_id]);
+      latAdd(&sh->latency[LAT_CHECKOUT], now - sh->leftAt[group_id]);
+      sh->groupRecord[group_id] = DONE;
+      sh->fSt.assignedTable[group_id] = -1;
+      releaseTables(sh->fSt.tableSet[group_id]);
+      sh->fSt.tableSet[group_id] = 0;
+      sh->fSt.st.groupStat[group_id] = LEAVING;
+    }
+}
+
+/**
+ *  \brief receptionist frees the tables of the groups that checked out at them
+ *
+ *  Receptionist updates its state, frees the tables left and checks if they
+ *  should be occupied by waiting groups, as after a payment. Nobody waits for
+ *  an acknowledge. The internal state should be saved.
+ *
+ */
+static void receiveCheckouts() {
+  if (semDownWatched(semgid, sh->mutex) == -1) { /* enter critical region */
+    perror("error on the up operation for semaphore access (RT)");
+    exit(EXIT_FAILURE);
+  }
+
+  sh->fSt.st.receptionistStat = RECVPAY;
+  utilBusy(&sh->util[self], true);
+  collectCheckouts();
+  updateHolds(nowUSec());
+  seatWaitingGroups();
+  saveState(nFic, &sh->fSt);
+
+  if (semUp(semgid, sh->mutex) == -1) { /* exit critical region */
     perror("error on the down operation for semaphore access (RT)");
     exit(EXIT_FAILURE);
   }
@@ -8,18 +8,30 @@
  *
  *  Definition of the operations carried out by the waiter:
  *     \li waitForClientOrChef
+ *     \li nextQueuedRequests (event front end)
+ *     \li stealRequests (event front end)
+ *     \li serveTrip
  *     \li informChef
  *     \li takeFoodToTable
  *
+ *  The floor may be divided into zones, each one served by its own waiter
+ *  through its own request channel: groups and chef route their requests to
+ *  the waiter of the zone of the table. With the event front end, a waiter
+ *  with nothing to do may take requests queued to another zone. With the
+ *  semaphore front end, the generator may spawn helpers that share the
+ *  channel of a busy zone, and retire them once it has quietened down.
+ *
  *  \author Nuno Lau - December 2023
  */
 
 #include <assert.h>
+#include <errno.h>
 #include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -29,6 +41,10 @@
 #include "semaphore.h"
 #include "sharedDataSync.h"
 #include "sharedMemory.h"
+#include "watchdog.h"
+#include "perfCounters.h"
+#include "metrics.h"
+#include "requestQueue.h"
 
 /** \brief logging file name */
 static char nFic[51];
@@ -42,14 +58,35 @@ static int semgid;
 /** \brief pointer to shared memory region */
 static SHARED_DATA *sh;
 
-/** \brief waiter waits for next request */
-static request waitForClientOrChef();
+/** \brief zone served by this waiter */
+static int zone;
+
+/** \brief entity id of this waiter */
+static unsigned int self;
+
+/** \brief number of this waiter among the helpers spawned by the generator (-1 if it is not a helper) */
+static int helper;
+
+/** \brief waiter waits for next requests */
+static int waitForClientOrChef(request trip[]);
+
+/** \brief waiter takes the next queued requests, if any (event front end) */
+static int nextQueuedRequests(request trip[]);
+
+/** \brief waiter takes requests queued to the busiest other zone (event front end) */
+static int stealRequests(request trip[]);
+
+/** \brief life cycle of the waiter with the event front end */
+static void serveEvents();
+
+/** \brief waiter serves the requests of one trip */
+static void serveTrip(request trip[], int n);
 
 /** \brief waiter takes food order to chef */
-static void informChef(int group);
+static int informChef(int group, int dish);
 
 /** \brief waiter takes food to table */
-static void takeFoodToTable(int group);
+static int takeFoodToTable(int group);
 
 /**
  *  \brief Main program.
@@ -62,7 +99,7 @@ int main(int argc, char *argv[]) {
   char *tinp; /* numerical parameters test flag */
 
   /* validation of command line parameters */
-  if (argc != 4) {
+  if (argc != 6) {
     freopen("error_WT", "a", stderr);
     fprintf(stderr, "Number of parameters is incorrect!\n");
     return EXIT_FAILURE;
@@ -77,6 +114,19 @@ int main(int argc, char *argv[]) {
     fprintf(stderr, "Error on the access key communication!\n");
     return EXIT_FAILURE;
   }
+  zone = (int)strtol(argv[4], &tinp, 0);
+  if ((*tinp != '\0') || (zone < 0) || (zone >= MAXWAITERS)) {
+    fprintf(stderr, "Zone value is out of range!\n");
+    return EXIT_FAILURE;
+  }
+  helper = (int)strtol(argv[5], &tinp, 0);
+  if ((*tinp != '\0') || (helper < -1) || (helper >= MAXHELPERS)) {
+    fprintf(stderr, "Helper value is out of range!\n");
+    return EXIT_FAILURE;
+  }
+  self = (helper >= 0)  ? HELPERS_ID + (unsigned int)helper
+         : (zone == 0) ? WAITER_ID
+                       : WAITERS_ID + (unsigned int)(zone - 1);
 
   /* connection to the semaphore set and the shared memory region and mapping
      the shared region onto the process address space */
@@ -93,23 +143,40 @@ int main(int argc, char *argv[]) {
     return EXIT_FAILURE;
   }
 
+  /* register entity for stall detection */
+  watchdogInit(sh, self);
+
+  /* spin-then-block waiting, if requested */
+  if (sh->fSt.spinMax > 0) {
+    semSpinEnable(sh->semShadow, sh->fSt.spinMax);
+  }
+
   /* initialize random generator */
   srandom((unsigned int)getpid());
 
+  /* start counting hardware events, if requested */
+  if (sh->fSt.perfCounters) {
+    perfStart();
+  }
+
+  /* start busy/idle accounting */
+  utilStart(&sh->util[self]);
+
   /* simulation of the life cycle of the waiter */
-  int nReq = 0;
-  request req;
-  while (nReq < sh->fSt.nGroups * 2) {
-    req = waitForClientOrChef();
-    switch (req.reqType) {
-    case FOODREQ:
-      informChef(req.reqGroup);
-      break;
-    case FOODREADY:
-      takeFoodToTable(req.reqGroup);
-      break;
-    }
-    nReq++;
+  int n;
+  request trip[MAXGROUPS];
+  if (sh->fSt.waiterEvents)
+    serveEvents();
+  else
+    while ((n = waitForClientOrChef(trip)) > 0)
+      serveTrip(trip, n);
+
+  /* publishing accounting data */
+  utilStop(&sh->util[self]);
+  sh->semOps[self] = semOpCount();
+  semSpinStats(&sh->spinHits[self], &sh->spinMisses[self]);
+  if (sh->fSt.perfCounters) {
+    perfStop(sh->perfCount[self]);
   }
 
   /* unmapping the shared region off the process address space */
@@ -124,17 +191,26 @@ int main(int argc, char *argv[]) {
 }
 
 /**
- *  \brief waiter waits for next request
+ *  \brief waiter waits for next requests
  *
  *  Waiter updates state and waits for request from group or from chef, then
- * reads request. The waiter should signal that new requests are possible. The
- * internal state should be saved.
+ * collects the requests already pending, up to the trip capacity. Food that is
+ * ready goes first. The waiter should signal that new requests are possible.
+ * A helper wakes up every sampling period of the generator, to leave once it is
+ * retired. The wakeup of the generator closing the restaurant is passed on to
+ * the other waiters of the zone.
+ * The internal state should be saved.
  *
- *  \return request submitted by group or chef
+ *  \param trip location where the requests submitted by groups or chef are
+ * stored
+ *
+ *  \return number of requests (0 once the restaurant is closing)
  */
-static request waitForClientOrChef() {
-  request req;
-  if (semDown(semgid, sh->mutex) == -1) { /* enter critical region */
+static int waitForClientOrChef(request trip[]) {
+  bool group = false;
+  int n, i;
+
+  if (semDownWatched(semgid, sh->mutex) == -1) { /* enter critical region */
     perror("error on the up operation for semaphore access (WT)");
     exit(EXIT_FAILURE);
   }
@@ -143,6 +219,7 @@ static request waitForClientOrChef() {
   // requests
   sh->fSt.st.waiterStat = WAIT_FOR_REQUEST;
   saveState(nFic, &sh->fSt);
+  utilBusy(&sh->util[self], false);
 
   if (semUp(semgid, sh->mutex) == -1) { /* exit critical region */
     perror("error on the down operation for semaphore access (WT)");
@@ -150,120 +227,325 @@ static request waitForClientOrChef() {
   }
 
   // After doing this, we have to wait for someone to send us a request;
-  if (semDown(semgid, sh->waiterRequest) == -1) {
-    perror("error on the up operation for semaphore access (WT)");
-    exit(EXIT_FAILURE);
-  }
+  if (helper < 0) {
+    if (semDownWatched(semgid, sh->waiterRequest[zone]) == -1) {
+      perror("error on the up operation for semaphore access (WT)");
+      exit(EXIT_FAILURE);
+    }
+  } else
+    while (semDownTimed(semgid, sh->waiterRequest[zone],
+                        sh->fSt.elasticPeriod) == -1) {
+      if (errno != EAGAIN) {
+        perror("error on the down operation for semaphore access (WT)");
+        exit(EXIT_FAILURE);
+      }
+      if (__atomic_load_n(&sh->retire[helper], __ATOMIC_SEQ_CST) ||
+          __atomic_load_n(&sh->closing, __ATOMIC_SEQ_CST))
+        return 0;
+    }
+
+  // and we take along whatever else is pending, without waiting for it
+  for (n = 1; n < (int)sh->fSt.tripSize; n++)
+    if (semDownTimed(semgid, sh->waiterRequest[zone], 0) == -1) {
+      if (errno != EAGAIN) {
+        perror("error on the down operation for semaphore access (WT)");
+        exit(EXIT_FAILURE);
+      }
+      break;
+    }
 
-  // If we get a request, we need to enter the critical region again,
-  // so we can get the data needed to process said request;
+  // If we get requests, we need to enter the critical region again,
+  // so we can get the data needed to process said requests;
 
-  if (semDown(semgid, sh->mutex) == -1) { /* enter critical region */
+  if (semDownWatched(semgid, sh->mutex) == -1) { /* enter critical region */
     perror("error on the up operation for semaphore access (WT)");
     exit(EXIT_FAILURE);
   }
 
-  // We need to get the data from the request given to the waiter,
-  // so we can then process it.
-  req = sh->fSt.waiterRequest;
+  // We need to get the data from the requests given to the waiter,
+  // so we can then process them. Food that is ready goes first, so it does
+  // not get cold behind new orders (there is at most one group request, as
+  // groups share a single slot). Once every group has left, the wakeup can
+  // only come from the generator closing the restaurant.
+  for (i = 0; i < n; i++)
+    if (!rqPop(&sh->fSt.foodReadyQueue[zone], &trip[i])) {
+      if (sh->closing)
+        break;
+      trip[i] = sh->fSt.waiterRequest[zone];
+      group = true;
+    }
 
   if (semUp(semgid, sh->mutex) == -1) { /* exit critical region */
     perror("error on the down operation for semaphore access (WT)");
     exit(EXIT_FAILURE);
   }
 
+  // Wakeups left over are the closing one, which other waiters of the zone
+  // may be waiting for too
+  for (; n > i; n--)
+    if (semUp(semgid, sh->waiterRequest[zone]) == -1) {
+      perror("error on the down operation for semaphore access (WT)");
+      exit(EXIT_FAILURE);
+    }
+
   // After all this, we need to signal that the waiter is now able to process
-  // the request, since he now has the data
+  // the request of a group, since he now has the data (the chef queues
+  // its notices)
 
-  if (semUp(semgid, sh->waiterRequestPossible) == -1) {
+  if (group && semUp(semgid, sh->waiterRequestPossible[zone]) == -1) {
     perror("error on the down operation for semaphore access (WT)");
     exit(EXIT_FAILURE);
   }
 
-  return req;
+  return n;
 }
 
 /**
- *  \brief waiter takes food order to chef
+ *  \brief waiter takes the next queued requests, if any (event front end)
  *
- *  Waiter updates state and then takes food request to chef.
- *  Waiter should inform group that request is received.
- *  Waiter should wait for chef receiving request.
- *  The internal state should be saved.
+ *  Chef notices are always taken before group requests, so that ready food
+ * is not kept waiting behind new orders, up to the trip capacity. If both
+ * queues are empty, the waiter may take requests of another zone; if there
+ * are none either, it updates its state to wait for a request. The
+ * internal state should be saved.
+ *
+ *  \param trip location where the requests are stored
  *
+ *  \return number of requests taken (0 if both queues are empty)
  */
-static void informChef(int group_id) {
-  int table_id;
-  if (semDown(semgid, sh->mutex) == -1) { /* enter critical region */
+static int nextQueuedRequests(request trip[]) {
+  int n = 0;
+
+  if (semDownWatched(semgid, sh->mutex) == -1) { /* enter critical region */
     perror("error on the up operation for semaphore access (WT)");
     exit(EXIT_FAILURE);
   }
 
-  // If we are giving a request to the chef, then we need to update our state
-  sh->fSt.st.waiterStat = INFORM_CHEF;
-  saveState(nFic, &sh->fSt);
-  // Then we need to setup all the flags and request for the chef
-  sh->fSt.foodOrder = 1;
-  sh->fSt.foodGroup = group_id;
-  // We also need to know the table that did the request
-  table_id = sh->fSt.assignedTable[group_id];
+  while ((n < (int)sh->fSt.tripSize) &&
+         (rqPop(&sh->fSt.foodReadyQueue[zone], &trip[n]) ||
+          rqPop(&sh->fSt.foodReqQueue[zone], &trip[n])))
+    n++;
+  if ((n == 0) && sh->fSt.steal)
+    n = stealRequests(trip);
+  sh->zoneBusy[zone] = (n > 0);
+
+  // With nothing left to do, the waiter becomes available for requests
+  if (n == 0) {
+    sh->fSt.st.waiterStat = WAIT_FOR_REQUEST;
+    saveState(nFic, &sh->fSt);
+    utilBusy(&sh->util[self], false);
+  }
 
-  if (semUp(semgid, sh->mutex) == -1) /* exit critical region */
-  {
+  if (semUp(semgid, sh->mutex) == -1) { /* exit critical region */
     perror("error on the down operation for semaphore access (WT)");
     exit(EXIT_FAILURE);
   }
-  // We then signal the group that their request has been received
 
-  if (semUp(semgid, sh->requestReceived[table_id]) == -1) {
-    perror("error on the down operation for semaphore access (WT)");
-    exit(EXIT_FAILURE);
+  return n;
+}
+
+/**
+ *  \brief waiter takes requests queued to the busiest other zone (event front end)
+ *
+ *  Zones whose waiter is serving a trip, or that have more than one request
+ * queued, may be stolen from; the one with the most requests queued is chosen.
+ * The newest requests are taken, ready food first, up to half of them (and the
+ * trip capacity), so that its waiter goes on with the oldest ones.
+ *  Called within the critical region.
+ *
+ *  \param trip location where the requests are stored
+ *
+ *  \return number of requests taken (0 if no zone may be stolen from)
+ */
+static int stealRequests(request trip[]) {
+  int victim = -1, most = 0, queued, n = 0;
+
+  for (int z = 0; z < (int)sh->fSt.nWaiters; z++) {
+    queued = sh->fSt.foodReadyQueue[z].count + sh->fSt.foodReqQueue[z].count;
+    if ((z != zone) && (sh->zoneBusy[z] || (queued > 1)) && (queued > most)) {
+      victim = z;
+      most = queued;
+    }
   }
+  if (victim == -1)
+    return 0;
+
+  while ((n < (int)sh->fSt.tripSize) && (n < (most + 1) / 2) &&
+         (rqSteal(&sh->fSt.foodReadyQueue[victim], &trip[n]) ||
+          rqSteal(&sh->fSt.foodReqQueue[victim], &trip[n])))
+    n++;
+  sh->zoneSteals[zone] += (unsigned long)n;
+  sh->zoneStolen[victim] += (unsigned long)n;
+  return n;
+}
 
-  if (semUp(semgid, sh->waitOrder) == -1) {
-    perror("error on the down operation for semaphore access (WT)");
+/**
+ *  \brief life cycle of the waiter with the event front end
+ *
+ *  Groups and chef queue their requests and signal an eventfd each, per zone;
+ * the generator signals a third one, common to every zone, when all groups
+ * have left. The waiter
+ * multiplexes the three with epoll, drains the queues after every wakeup and
+ * leaves once shutdown was signalled and nothing is left queued. A waiter
+ * that steals also watches the eventfds of the other zones, edge-triggered
+ * and without consuming them, to be woken up when work is queued there.
+ */
+static void serveEvents() {
+  struct epoll_event ev[1 + 2 * MAXWAITERS];
+  int fd[1 + 2 * MAXWAITERS] = {sh->foodReqEvent[zone],
+                                sh->foodReadyEvent[zone], sh->shutdownEvent};
+  bool shutdown = false;
+  request trip[MAXGROUPS];
+  int epfd, n, i, nFd = 3;
+
+  for (int z = 0; sh->fSt.steal && (z < (int)sh->fSt.nWaiters); z++)
+    if (z != zone) {
+      fd[nFd++] = sh->foodReqEvent[z];
+      fd[nFd++] = sh->foodReadyEvent[z];
+    }
+
+  if ((epfd = epoll_create1(0)) == -1) {
+    perror("error on creating the epoll instance (WT)");
     exit(EXIT_FAILURE);
   }
+  for (i = 0; i < nFd; i++) {
+    ev[i].events = (i < 3) ? EPOLLIN : EPOLLIN | EPOLLET;
+    ev[i].data.fd = fd[i];
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd[i], &ev[i]) == -1) {
+      perror("error on registering an eventfd (WT)");
+      exit(EXIT_FAILURE);
+    }
+  }
 
-  // We also have to wait for the order to be received
+  while (true) {
+    while ((n = nextQueuedRequests(trip)) > 0)
+      serveTrip(trip, n);
+    if (shutdown)
+      break;
 
-  if (semDown(semgid, sh->orderReceived) == -1) {
-    perror("error on the up operation for semaphore access (WT)");
-    exit(EXIT_FAILURE);
+    // Notifications are consumed before the queues are drained again, so a
+    // request queued meanwhile is either drained now or wakes us up later
+    if ((n = eventWaitWatched(semgid, epfd, ev, nFd)) == -1) {
+      perror("error on waiting for events (WT)");
+      exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < n; i++)
+      if (ev[i].data.fd == sh->shutdownEvent)
+        shutdown = true; // left signalled for the waiters of the other zones
+      else if ((ev[i].data.fd == sh->foodReqEvent[zone]) ||
+               (ev[i].data.fd == sh->foodReadyEvent[zone]))
+        rqConsume(ev[i].data.fd);
   }
+
+  close(epfd);
 }
 
 /**
- *  \brief waiter takes food to table
+ *  \brief waiter serves the requests of one trip
  *
- *  Waiter updates its state and takes food to table, allowing the meal to
- * start. Group must be informed that food is available. The internal state
- * should be saved.
+ *  Waiter goes through all the requests within a single critical region,
+ * then informs every group whose order was taken, wakes up the chef once per
+ * order and lets every group whose food was delivered start eating.
  *
+ *  \param trip requests of the trip
+ *  \param n number of requests
  */
+static void serveTrip(request trip[], int n) {
+  int table[MAXGROUPS];
+  int i;
 
-static void takeFoodToTable(int group_id) {
-  if (semDown(semgid, sh->mutex) == -1) { /* enter critical region */
+  if (semDownWatched(semgid, sh->mutex) == -1) { /* enter critical region */
     perror("error on the up operation for semaphore access (WT)");
     exit(EXIT_FAILURE);
   }
 
-  // If the waiter is taking the food to the table, we once again
-  // have to update his state
-  sh->fSt.st.waiterStat = TAKE_TO_TABLE;
-  saveState(nFic, &sh->fSt);
-
-  // Then we signaled the group that their food has arrived and that
-  // they can start eating.
+  for (i = 0; i < n; i++)
+    switch (trip[i].reqType) {
+    case FOODREQ:
+      table[i] = informChef(trip[i].reqGroup, trip[i].reqDish);
+      break;
+    case FOODREADY:
+      table[i] = takeFoodToTable(trip[i].reqGroup);
+      break;
+    }
+  sh->trips += 1;
+  sh->tripRequests += (unsigned long)n;
+  sh->zoneTrips[zone] += 1;
+  sh->zoneRequests[zone] += (unsigned long)n;
 
-  int table_id = sh->fSt.assignedTable[group_id];
-  if (semUp(semgid, sh->foodArrived[table_id]) == -1) {
+  if (semUp(semgid, sh->mutex) == -1) { /* exit critical region */
     perror("error on the down operation for semaphore access (WT)");
     exit(EXIT_FAILURE);
   }
 
-  if (semUp(semgid, sh->mutex) == -1) { /* exit critical region */
-    perror("error on the down operation for semaphore access (WT)");
+  for (i = 0; i < n; i++)
+    if (trip[i].reqType == FOODREQ) {
+      // We signal the group that their request has been received, and the
+      // chef of the dish that there is one more order queued
+      if ((semUp(semgid, sh->requestReceived[table[i]]) == -1) ||
+          (semUp(semgid, sh->waitOrder[trip[i].reqDish]) == -1)) {
+        perror("error on the down operation for semaphore access (WT)");
+        exit(EXIT_FAILURE);
+      }
+    } else if (semUp(semgid, sh->foodArrived[table[i]]) == -1) {
+      // We signal the group that their food has arrived and that they can
+      // start eating
+      perror("error on the down operation for semaphore access (WT)");
+      exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ *  \brief waiter takes food order to chef
+ *
+ *  Waiter updates state and then queues the food request to the chef of the
+ * dish ordered.
+ *  Waiter does not wait for chef receiving request: the chef takes it from the
+ * queue whenever it is ready to cook.
+ *  The internal state should be saved.
+ *  Called within the critical region; informing the group is up to the caller.
+ *
+ *  \param group_id group that ordered
+ *  \param dish dish ordered
+ *
+ *  \return table of the group
+ */
+static int informChef(int group_id, int dish) {
+  // If we are giving a request to the chef, then we need to update our state
+  sh->fSt.st.waiterStat = INFORM_CHEF;
+  saveState(nFic, &sh->fSt);
+  utilBusy(&sh->util[self], true);
+  // Then we need to queue the request for the chef and setup all the flags
+  request order = {FOODREQ, group_id, dish};
+  if (!rqPush(&sh->fSt.orderQueue[dish], order)) {
+    fprintf(stderr, "order queue is full (WT)\n");
     exit(EXIT_FAILURE);
   }
+  avgSet(&sh->orderQueueAvg[dish], sh->fSt.orderQueue[dish].count);
+  sh->fSt.foodOrder += 1;
+  sh->fSt.foodGroup = group_id;
+  sh->orderedAt[group_id] = nowUSec();
+  // We also need to know the table that did the request
+  return sh->fSt.assignedTable[group_id];
+}
+
+/**
+ *  \brief waiter takes food to table
+ *
+ *  Waiter updates its state and takes food to table, allowing the meal to
+ * start. The internal state should be saved.
+ *  Called within the critical region; informing the group that food is
+ * available is up to the caller.
+ *
+ *  \return table of the group
+ */
+static int takeFoodToTable(int group_id) {
+  // If the waiter is taking the food to the table, we once again
+  // have to update his state
+  sh->fSt.st.waiterStat = TAKE_TO_TABLE;
+  saveState(nFic, &sh->fSt);
+  utilBusy(&sh->util[self], true);
+  latAdd(&sh->latency[LAT_SERVE], nowUSec() - sh->cookedAt[group_id]);
+
+  return sh->fSt.assignedTable[group_id];
 }
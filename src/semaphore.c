@@ -9,12 +9,20 @@
  *     \li destruction of a previously created set of semaphores
  *     \li signalling start of operations
  *     \li <em>down</em> of a semaphore within the set
- *     \li <em>up</em> of a semaphore within the set.
+ *     \li <em>down</em> of a semaphore within the set with a timeout
+ *     \li <em>up</em> of a semaphore within the set
+ *     \li inspection of the value and of the number of waiters of a semaphore within the set
+ *     \li number of <em>down</em> and <em>up</em> operations issued by the process
+ *     \li adaptive spin-then-block waiting on <em>down</em>.
  *
  *  \author António Rui Borges - October 1995
  */
 
+#define _GNU_SOURCE
+
 #include <stdio.h>
+#include <stdbool.h>
+#include <time.h>
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <sys/sem.h>
@@ -23,6 +31,105 @@
 /** \brief access permission: user r-w */
 #define  MASK           0600
 
+/** \brief number of down and up system calls issued by the process */
+static unsigned long nOps = 0;
+
+/** \brief number of semaphores in a set that may be spun on */
+#define  SPINSEMS        256
+/** \brief smallest spin budget (iterations) */
+#define  SPINMIN          16
+/** \brief blocking waits shorter than this (in microseconds) would have been caught by spinning longer */
+#define  SPINSHORT        50
+
+/** \brief shadow of the semaphore values in shared memory (NULL if spinning is off) */
+static int *shadow = NULL;
+
+/** \brief largest spin budget (iterations) */
+static unsigned int spinMax;
+
+/** \brief current spin budget of each semaphore (iterations) */
+static unsigned int budget[SPINSEMS];
+
+/** \brief number of contended downs satisfied while spinning and number of downs that had to block */
+static unsigned long spinHits = 0, spinMisses = 0;
+
+/* internal functions */
+
+static unsigned long long usecs (void)
+{
+  struct timespec ts;                                                                            /* current time */
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (unsigned long long) ts.tv_sec * 1000000ULL + (unsigned long long) ts.tv_nsec / 1000ULL;
+}
+
+static void cpuRelax (void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause ();
+#endif
+}
+
+/* spins on the shadow value while the budget lasts; true if the semaphore became available */
+
+static bool spinWait (unsigned int sindex)
+{
+  unsigned int n;                                                                          /* iterations spun */
+
+  if ((shadow == NULL) || (sindex >= SPINSEMS))
+     return false;
+  for (n = 0; n < budget[sindex]; n++)
+  { if (__atomic_load_n (&shadow[sindex], __ATOMIC_ACQUIRE) > 0)
+       { if (n > 0)                                                         /* not just an uncontended down */
+            spinHits += 1;
+         if ((2 * n > budget[sindex]) && (budget[sindex] < spinMax))                 /* close call: spin longer */
+            budget[sindex] = (2 * budget[sindex] < spinMax) ? 2 * budget[sindex] : spinMax;
+         return true;
+       }
+    cpuRelax ();
+  }
+  return false;
+}
+
+/* tunes the spin budget from the duration of a down that had to block */
+
+static void spinAdapt (unsigned int sindex, unsigned long long blocked)
+{
+  spinMisses += 1;
+  if (blocked < SPINSHORT)
+     budget[sindex] = (2 * budget[sindex] < spinMax) ? 2 * budget[sindex] : spinMax;
+     else budget[sindex] = (budget[sindex] / 2 > SPINMIN) ? budget[sindex] / 2 : SPINMIN;
+}
+
+/* down with optional spinning and timeout (NULL for none) */
+
+static int downOp (int semgid, unsigned int sindex, struct timespec *ts)
+{
+  struct sembuf down = { 0, -1, 0 };                                                      /* specific down operation */
+  bool spun;                                                                      /* semaphore seen up while spinning */
+  unsigned long long t0 = 0;                                                                /* start of blocking wait */
+  int ret;
+
+  assert(sindex>0);
+  down.sem_num = (unsigned short) sindex;
+  spun = spinWait (sindex);
+  if ((shadow != NULL) && !spun && (sindex < SPINSEMS))
+     t0 = usecs ();
+  nOps += 1;
+  if ((ts != NULL) && (ts->tv_sec == 0) && (ts->tv_nsec == 0))
+     { down.sem_flg = IPC_NOWAIT;                                        /* only trying, fails with EAGAIN */
+       ts = NULL;
+     }
+  ret = (ts == NULL) ? semop (semgid, &down, 1) : semtimedop (semgid, &down, 1, ts);
+  if ((shadow != NULL) && (sindex < SPINSEMS))
+     { if (ret == 0)
+          __atomic_fetch_sub (&shadow[sindex], 1, __ATOMIC_RELEASE);
+       if (!spun)
+          spinAdapt (sindex, usecs () - t0);
+     }
+  return ret;
+}
+
 /**
  *  \brief Creation of a set of semaphores.
  *
@@ -112,11 +219,7 @@ int semSignal (int semgid)
 
 int semDown (int semgid, unsigned int sindex)
 {
-  struct sembuf down = { 0, -1, 0 };                                                      /* specific down operation */
-
-  assert(sindex>0);
-  down.sem_num = (unsigned short) sindex;
-  return semop (semgid, &down, 1);
+  return downOp (semgid, sindex, NULL);
 }
 
 /**
@@ -137,5 +240,113 @@ int semUp (int semgid, unsigned int sindex)
 
   assert(sindex>0);
   up.sem_num = (unsigned short) sindex;
-  return semop (semgid, &up, 1);
+  nOps += 1;
+  if (semop (semgid, &up, 1) == -1)
+     return -1;
+  if ((shadow != NULL) && (sindex < SPINSEMS))
+     __atomic_fetch_add (&shadow[sindex], 1, __ATOMIC_RELEASE);
+  return 0;
+}
+
+/**
+ *  \brief <em>Down</em> of a semaphore within the set with a timeout.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>, or if the
+ *  operation could not be carried out within <tt>timeout</tt> microseconds (<tt>errno</tt> is set to
+ *  <tt>EAGAIN</tt>).
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param timeout maximum blocking time (in microseconds, 0 only tries)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semDownTimed (int semgid, unsigned int sindex, unsigned int timeout)
+{
+  struct timespec ts;                                                                          /* relative timeout */
+
+  ts.tv_sec = timeout / 1000000;
+  ts.tv_nsec = (long) (timeout % 1000000) * 1000L;
+  return downOp (semgid, sindex, &ts);
+}
+
+/**
+ *  \brief Value of a semaphore within the set.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return semaphore value, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semGetValue (int semgid, unsigned int sindex)
+{
+  return semctl (semgid, (int) sindex, GETVAL);
+}
+
+/**
+ *  \brief Number of processes blocked on a <em>down</em> of a semaphore within the set.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return number of waiting processes, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semGetWaiting (int semgid, unsigned int sindex)
+{
+  return semctl (semgid, (int) sindex, GETNCNT);
+}
+
+/**
+ *  \brief Number of <em>down</em> and <em>up</em> operations issued by the process.
+ *
+ *  Every operation is a system call, so this is the synchronization share of the system calls of the process.
+ *
+ *  \return number of operations
+ */
+
+unsigned long semOpCount (void)
+{
+  return nOps;
+}
+
+/**
+ *  \brief Enabling adaptive spin-then-block waiting on <em>down</em>.
+ *
+ *  Every <em>up</em> and <em>down</em> of the process keeps a shadow of the semaphore values in shared memory.
+ *  Before blocking, a <em>down</em> spins on the shadow value, without system calls, for a budget of iterations
+ *  that is tuned per semaphore: it is doubled when a wait blocked only briefly or was satisfied late in the spin,
+ *  and halved when a wait blocked for long. The shadow is only a hint, the semaphore itself is always used.
+ *  All processes operating on the set must enable it with the same shadow for the hints to be accurate.
+ *
+ *  \param p_shadow shadow of the semaphore values (one per semaphore in the set, initially the semaphore values)
+ *  \param maxSpin largest spin budget (iterations)
+ */
+
+void semSpinEnable (int *p_shadow, unsigned int maxSpin)
+{
+  unsigned int s;
+
+  shadow = p_shadow;
+  spinMax = (maxSpin > SPINMIN) ? maxSpin : SPINMIN;
+  for (s = 0; s < SPINSEMS; s++)
+    budget[s] = spinMax;
+}
+
+/**
+ *  \brief Statistics of spin-then-block waiting.
+ *
+ *  \param hits location where the number of downs satisfied while spinning is stored
+ *  \param misses location where the number of downs that had to block is stored
+ */
+
+void semSpinStats (unsigned long *hits, unsigned long *misses)
+{
+  *hits = spinHits;
+  *misses = spinMisses;
 }
@@ -9,7 +9,11 @@
  *     \li destruction of a previously created set of semaphores
  *     \li signalling start of operations
  *     \li <em>down</em> of a semaphore within the set
- *     \li <em>up</em> of a semaphore within the set.
+ *     \li <em>down</em> of a semaphore within the set with a timeout
+ *     \li <em>up</em> of a semaphore within the set
+ *     \li inspection of the value and of the number of waiters of a semaphore within the set
+ *     \li number of <em>down</em> and <em>up</em> operations issued by the process
+ *     \li adaptive spin-then-block waiting on <em>down</em>.
  *
  *  \author António Rui Borges - October 1995
  */
@@ -99,4 +103,77 @@ extern int semDown (int semgid, unsigned int sindex);
 
 extern int semUp (int semgid, unsigned int sindex);
 
+/**
+ *  \brief <em>Down</em> of a semaphore within the set with a timeout.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>, or if the
+ *  operation could not be carried out within <tt>timeout</tt> microseconds (<tt>errno</tt> is set to
+ *  <tt>EAGAIN</tt>).
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param timeout maximum blocking time (in microseconds, 0 only tries)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semDownTimed (int semgid, unsigned int sindex, unsigned int timeout);
+
+/**
+ *  \brief Value of a semaphore within the set.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return semaphore value, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semGetValue (int semgid, unsigned int sindex);
+
+/**
+ *  \brief Number of processes blocked on a <em>down</em> of a semaphore within the set.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return number of waiting processes, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semGetWaiting (int semgid, unsigned int sindex);
+
+/**
+ *  \brief Number of <em>down</em> and <em>up</em> operations issued by the process.
+ *
+ *  Every operation is a system call, so this is the synchronization share of the system calls of the process.
+ *
+ *  \return number of operations
+ */
+
+extern unsigned long semOpCount (void);
+
+/**
+ *  \brief Enabling adaptive spin-then-block waiting on <em>down</em>.
+ *
+ *  Before blocking, a <em>down</em> spins on a shadow of the semaphore value kept in shared memory, for a budget
+ *  of iterations tuned per semaphore from the observed waits.
+ *  All processes operating on the set must enable it with the same shadow for the hints to be accurate.
+ *
+ *  \param p_shadow shadow of the semaphore values (one per semaphore in the set, initially the semaphore values)
+ *  \param maxSpin largest spin budget (iterations)
+ */
+
+extern void semSpinEnable (int *p_shadow, unsigned int maxSpin);
+
+/**
+ *  \brief Statistics of spin-then-block waiting.
+ *
+ *  \param hits location where the number of downs satisfied while spinning is stored
+ *  \param misses location where the number of downs that had to block is stored
+ */
+
+extern void semSpinStats (unsigned long *hits, unsigned long *misses);
+
 #endif /* SEMAPHORE_H_ */
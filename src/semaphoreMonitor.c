@@ -0,0 +1,452 @@
+/**
+ *  \file semaphoreMonitor.c (implementation file)
+ *
+ *  \brief Semaphore management, implemented as a process-shared monitor.
+ *
+ *  Alternative implementation of the operations of semaphore.h: instead of a SVIPC semaphore set, the set
+ *  is a shared memory block holding a pthread mutex (the monitor lock) and, for each semaphore, its value
+ *  and a condition variable, all with the PTHREAD_PROCESS_SHARED attribute. Every semaphore is a waiting
+ *  reason of the protocol, so an <em>up</em> signals only the processes waiting for that reason, and an
+ *  uncontended operation does not enter the kernel at all.
+ *
+ *  The MUTEX semaphore of the protocol is not emulated: it is the monitor lock itself. A <em>down</em> on
+ *  it acquires the lock and keeps it until the matching <em>up</em>, so a critical region takes a single
+ *  lock, and the operations issued inside it run on the lock already held. Inside the region a
+ *  <em>down</em> on another semaphore never waits, as waiting would release the region (it fails with
+ *  <tt>EDEADLK</tt>, or <tt>EAGAIN</tt> when timed); the protocol never does it.
+ *
+ *  The shared block is created with key <tt>key</tt>+1, as <tt>key</tt> identifies the shared region of the
+ *  problem. Only one set may be used by a process.
+ *
+ *  Operations defined on semaphores:
+ *     \li creation of a set of semaphores
+ *     \li connection to a previously created set of semaphores
+ *     \li destruction of a previously created set of semaphores
+ *     \li signalling start of operations
+ *     \li <em>down</em> of a semaphore within the set
+ *     \li <em>down</em> of a semaphore within the set with a timeout
+ *     \li <em>up</em> of a semaphore within the set
+ *     \li inspection of the value and of the number of waiters of a semaphore within the set
+ *     \li number of <em>down</em> and <em>up</em> operations issued by the process
+ *     \li adaptive spin-then-block waiting on <em>down</em> (not supported, waits always block).
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <assert.h>
+
+#include "semaphore.h"
+#include "sharedDataSync.h"
+
+/** \brief access permission: user r-w */
+#define  MASK           0600
+
+/**
+ *  \brief Definition of a semaphore of the monitor.
+ */
+typedef struct
+        { /** \brief semaphore value */
+          unsigned int value;
+          /** \brief number of processes blocked on the condition */
+          unsigned int waiting;
+          /** \brief condition the waiting processes block on */
+          pthread_cond_t cond;
+        } MONSEM;
+
+/**
+ *  \brief Definition of the monitor (set of semaphores).
+ */
+typedef struct
+        { /** \brief monitor lock (also the MUTEX semaphore) */
+          pthread_mutex_t lock;
+          /** \brief number of processes blocked on the monitor lock */
+          unsigned int contending;
+          /** \brief condition signalled at the start of operations */
+          pthread_cond_t start;
+          /** \brief operations have started */
+          bool started;
+          /** \brief number of semaphores in the set (location 0 is not used) */
+          unsigned int snum;
+          /** \brief semaphores of the set */
+          MONSEM sem[];
+        } MONITOR;
+
+/** \brief monitor the process is attached to */
+static MONITOR *mon = NULL;
+
+/** \brief number of down and up operations issued by the process */
+static unsigned long nOps = 0;
+
+/** \brief the process holds the monitor lock as the MUTEX semaphore */
+static bool inRegion = false;
+
+/* internal functions */
+
+/* acquire the monitor lock with optional absolute timeout (NULL for none), returns 0 or ETIMEDOUT */
+
+static int lock (struct timespec *until)
+{
+  int stat;                                                                             /* status of the locking */
+
+  if ((stat = pthread_mutex_trylock (&mon->lock)) == EBUSY)
+     { __atomic_add_fetch (&mon->contending, 1, __ATOMIC_RELAXED);
+       stat = (until == NULL) ? pthread_mutex_lock (&mon->lock)
+                              : pthread_mutex_clocklock (&mon->lock, CLOCK_MONOTONIC, until);
+       __atomic_sub_fetch (&mon->contending, 1, __ATOMIC_RELAXED);
+     }
+  if (stat == EOWNERDEAD)                                                 /* previous owner died in the monitor */
+     { pthread_mutex_consistent (&mon->lock);
+       stat = 0;
+     }
+  return stat;
+}
+
+static void unlock (void)
+{
+  pthread_mutex_unlock (&mon->lock);
+}
+
+static int attach (int shmid)
+{
+  void *add;                                                                                    /* temporary pointer */
+
+  if ((add = shmat (shmid, (char *) NULL, 0)) == (void *) -1)
+     return -1;
+  mon = (MONITOR *) add;
+  return shmid;
+}
+
+/* down with optional absolute timeout (NULL for none) */
+
+static int downOp (unsigned int sindex, struct timespec *until)
+{
+  int stat;                                                                 /* status of the last lock or wait */
+
+  assert((sindex>0) && (sindex < mon->snum));
+  nOps += 1;
+  if (inRegion)                                            /* the lock is already held, waiting would release it */
+     { if (mon->sem[sindex].value == 0)
+          { errno = (until == NULL) ? EDEADLK : EAGAIN;
+            return -1;
+          }
+       mon->sem[sindex].value -= 1;
+       return 0;
+     }
+  if ((stat = lock (until)) != 0)
+     { errno = (stat == ETIMEDOUT) ? EAGAIN : stat;
+       return -1;
+     }
+  while ((mon->sem[sindex].value == 0) && (stat != ETIMEDOUT))
+  { mon->sem[sindex].waiting += 1;
+    stat = (until == NULL) ? pthread_cond_wait (&mon->sem[sindex].cond, &mon->lock)
+                           : pthread_cond_timedwait (&mon->sem[sindex].cond, &mon->lock, until);
+    mon->sem[sindex].waiting -= 1;
+    if (stat == EOWNERDEAD)                                               /* previous owner died in the monitor */
+       { pthread_mutex_consistent (&mon->lock);
+         stat = 0;
+       }
+  }
+  if (mon->sem[sindex].value == 0)
+     { unlock ();
+       errno = EAGAIN;
+       return -1;
+     }
+  mon->sem[sindex].value -= 1;
+  if (sindex == MUTEX)                                                /* the lock is kept until the region ends */
+     inRegion = true;
+  else
+     unlock ();
+  return 0;
+}
+
+/* external functions */
+
+/**
+ *  \brief Creation of a set of semaphores.
+ *
+ *  All semaphores in the set will be in set to <em>red state</em> upon creation.
+ *  The function fails if there is already a set with a creation key equal to <tt>key</tt>, or if the monitor
+ *  lock and conditions cannot be made process-shared (the block is then removed).
+ *
+ *  \param key creation key
+ *  \param snum number of semaphores in the set (>= 1)
+ *
+ *  \return set identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semCreate (int key, unsigned int snum)
+{
+  int shmid;                                                                                   /* block identifier */
+  pthread_mutexattr_t mattr;                                                                /* monitor lock attributes */
+  pthread_condattr_t cattr;                                                                  /* condition attributes */
+  int stat;                                                                 /* status of the last pthread call */
+  unsigned int s;
+
+  if ((shmid = shmget ((key_t) key + 1, sizeof (MONITOR) + (snum + 1) * sizeof (MONSEM),
+                       MASK | IPC_CREAT | IPC_EXCL)) == -1)
+     return -1;
+  if (attach (shmid) == -1)
+     { stat = errno;
+       shmctl (shmid, IPC_RMID, (struct shmid_ds *) NULL);
+       errno = stat;
+       return -1;
+     }
+
+  if ((stat = pthread_mutexattr_init (&mattr)) == 0)
+     { if (((stat = pthread_mutexattr_setpshared (&mattr, PTHREAD_PROCESS_SHARED)) == 0) &&
+           ((stat = pthread_mutexattr_setrobust (&mattr, PTHREAD_MUTEX_ROBUST)) == 0))
+          stat = pthread_mutex_init (&mon->lock, &mattr);
+       pthread_mutexattr_destroy (&mattr);
+     }
+  if ((stat == 0) && ((stat = pthread_condattr_init (&cattr)) == 0))
+     { if (((stat = pthread_condattr_setpshared (&cattr, PTHREAD_PROCESS_SHARED)) == 0) &&
+           ((stat = pthread_condattr_setclock (&cattr, CLOCK_MONOTONIC)) == 0))
+          stat = pthread_cond_init (&mon->start, &cattr);
+       for (s = 0; (stat == 0) && (s <= snum); s++)
+       { mon->sem[s].value = mon->sem[s].waiting = 0;
+         stat = pthread_cond_init (&mon->sem[s].cond, &cattr);
+       }
+       pthread_condattr_destroy (&cattr);
+     }
+  if (stat != 0)                                  /* a process-private monitor would not synchronize anything */
+     { shmdt ((void *) mon);
+       mon = NULL;
+       shmctl (shmid, IPC_RMID, (struct shmid_ds *) NULL);
+       errno = stat;
+       return -1;
+     }
+  mon->contending = 0;
+  mon->started = false;
+  mon->snum = snum + 1;
+
+  return shmid;
+}
+
+/**
+ *  \brief Connection to a previously created set of semaphores.
+ *
+ *  The function fails if there is no set with a creation key equal to <tt>key</tt>.
+ *  The calling process is blocked until the start of operations is signalled.
+ *
+ *  \param key creation key
+ *
+ *  \return set identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semConnect (int key)
+{
+  int shmid;                                                                                   /* block identifier */
+
+  if (((shmid = shmget ((key_t) key + 1, 1, MASK)) == -1) || (attach (shmid) == -1))
+     return -1;
+  lock (NULL);
+  while (!mon->started)
+    pthread_cond_wait (&mon->start, &mon->lock);
+  unlock ();
+  return shmid;
+}
+
+/**
+ *  \brief Destruction of a previously created set of semaphores.
+ *
+ *  The function fails if there is no set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semDestroy (int semgid)
+{
+  unsigned int s;
+
+  for (s = 0; s < mon->snum; s++)
+    pthread_cond_destroy (&mon->sem[s].cond);
+  pthread_cond_destroy (&mon->start);
+  pthread_mutex_destroy (&mon->lock);
+  shmdt ((void *) mon);
+  mon = NULL;
+  return shmctl (semgid, IPC_RMID, (struct shmid_ds *) NULL);
+}
+
+/**
+ *  \brief Signalling start of operations upon initialization of shared data structures.
+ *
+ *  The function fails if there is no set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semSignal (int semgid)
+{
+  (void) semgid;
+  lock (NULL);
+  mon->started = true;
+  pthread_cond_broadcast (&mon->start);
+  unlock ();
+  return 0;
+}
+
+/**
+ *  \brief <em>Down</em> of a semaphore within the set.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semDown (int semgid, unsigned int sindex)
+{
+  (void) semgid;
+  return downOp (sindex, NULL);
+}
+
+/**
+ *  \brief <em>Up</em> of a semaphore within the set.
+ *
+ *  Only one of the processes waiting on the semaphore, if any, is woken up. An <em>up</em> on MUTEX
+ *  issued inside the critical region releases the monitor lock.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semUp (int semgid, unsigned int sindex)
+{
+  (void) semgid;
+  assert((sindex>0) && (sindex < mon->snum));
+  nOps += 1;
+  if (!inRegion)
+     lock (NULL);
+  mon->sem[sindex].value += 1;
+  if (mon->sem[sindex].waiting > 0)
+     pthread_cond_signal (&mon->sem[sindex].cond);
+  if (sindex == MUTEX)                                                                   /* end of the region */
+     inRegion = false;
+  if (!inRegion)
+     unlock ();
+  return 0;
+}
+
+/**
+ *  \brief <em>Down</em> of a semaphore within the set with a timeout.
+ *
+ *  The function fails if the operation could not be carried out within <tt>timeout</tt> microseconds
+ *  (<tt>errno</tt> is set to <tt>EAGAIN</tt>).
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param timeout maximum blocking time (in microseconds, 0 only tries)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semDownTimed (int semgid, unsigned int sindex, unsigned int timeout)
+{
+  struct timespec until;                                                                       /* absolute timeout */
+
+  (void) semgid;
+  clock_gettime (CLOCK_MONOTONIC, &until);
+  until.tv_sec += timeout / 1000000;
+  until.tv_nsec += (long) (timeout % 1000000) * 1000L;
+  if (until.tv_nsec >= 1000000000L)
+     { until.tv_sec += 1;
+       until.tv_nsec -= 1000000000L;
+     }
+  return downOp (sindex, &until);
+}
+
+/**
+ *  \brief Value of a semaphore within the set.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return semaphore value, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semGetValue (int semgid, unsigned int sindex)
+{
+  (void) semgid;
+  return (int) mon->sem[sindex].value;
+}
+
+/**
+ *  \brief Number of processes blocked on a <em>down</em> of a semaphore within the set.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return number of waiting processes, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semGetWaiting (int semgid, unsigned int sindex)
+{
+  (void) semgid;
+  if (sindex == MUTEX)                                          /* those blocked on the lock wait for the region */
+     return (int) (mon->sem[sindex].waiting + __atomic_load_n (&mon->contending, __ATOMIC_RELAXED));
+  return (int) mon->sem[sindex].waiting;
+}
+
+/**
+ *  \brief Number of <em>down</em> and <em>up</em> operations issued by the process.
+ *
+ *  With the monitor, only contended operations enter the kernel (futex calls).
+ *
+ *  \return number of operations
+ */
+
+unsigned long semOpCount (void)
+{
+  return nOps;
+}
+
+/**
+ *  \brief Enabling adaptive spin-then-block waiting on <em>down</em>.
+ *
+ *  Not supported by the monitor implementation: waits always block on the condition variable.
+ *
+ *  \param p_shadow shadow of the semaphore values
+ *  \param maxSpin largest spin budget (iterations)
+ */
+
+void semSpinEnable (int *p_shadow, unsigned int maxSpin)
+{
+  (void) p_shadow;
+  (void) maxSpin;
+}
+
+/**
+ *  \brief Statistics of spin-then-block waiting.
+ *
+ *  \param hits location where the number of downs satisfied while spinning is stored
+ *  \param misses location where the number of downs that had to block is stored
+ */
+
+void semSpinStats (unsigned long *hits, unsigned long *misses)
+{
+  *hits = 0;
+  *misses = 0;
+}
@@ -20,6 +20,9 @@
 #include "probConst.h"
 #include "probDataStruct.h"
 
+/** \brief largest number of semaphores in the set */
+#define SEM_MAX              ( 6 + MAXGROUPS + 3*MAXTABLES + 2*(NUMSTATIONS-1) + 2*(MAXWAITERS-1) + (MAXDISHES-1) )
+
 /**
  *  \brief Definition of <em>shared information</em> data type.
  */
@@ -30,31 +33,155 @@ typedef struct
           /* semaphores ids */
           /** \brief identification of critical region protection semaphore – val = 1 */
           unsigned int mutex;
-          /** \brief identification of semaphore used by receptionist to wait for groups - val = 0 */
+          /** \brief identification of semaphore used by receptionists to wait for groups - val = 0 */
           unsigned int receptionistReq;
           /** \brief identification of semaphore used by groups to wait before issuing receptionist request - val = 1 */
           unsigned int receptionistRequestPossible;
-          /** \brief identification of semaphore used by waiter to wait for requests – val = 0  */
-          unsigned int waiterRequest;
-          /** \brief identification of semaphore used by groups and chef to wait before issuing waiter request - val = 1 */
-          unsigned int waiterRequestPossible;
-          /** \brief identification of semaphore used by chef to wait for order – val = 0  */
-          unsigned int waitOrder;
-          /** \brief identification of semaphore used by waiter to wait for chef – val = 0  */
-          unsigned int orderReceived;
+          /** \brief identification of semaphore used by the waiter of each zone to wait for requests – val = 0  */
+          unsigned int waiterRequest[MAXWAITERS];
+          /** \brief identification of semaphore used by groups to wait before issuing a request to the waiter of each zone - val = 1 */
+          unsigned int waiterRequestPossible[MAXWAITERS];
+          /** \brief identification of semaphore used by the chef of each dish to wait for order (counts queued orders) – val = 0  */
+          unsigned int waitOrder[MAXDISHES];
           /** \brief identification of semaphore used by groups to wait for table – val = 0 */
           unsigned int waitForTable[MAXGROUPS];
           /** \brief identification of semaphore used by groups to wait for waiter ackowledge – val = 0  */
-          unsigned int requestReceived[NUMTABLES];
+          unsigned int requestReceived[MAXTABLES];
           /** \brief identification of semaphore used by groups to wait for food – val = 0 */
-          unsigned int foodArrived[NUMTABLES];
+          unsigned int foodArrived[MAXTABLES];
           /** \brief identification of semaphore used by groups to wait for payment completed – val = 0 */
-          unsigned int tableDone[NUMTABLES];
+          unsigned int tableDone[MAXTABLES];
+          /** \brief identification of semaphore used by each station but the first to wait for work – val = 0 */
+          unsigned int stationItems[NUMSTATIONS];
+          /** \brief identification of semaphore used to wait for room in the queue of each station but the first – val = stationQueueSize */
+          unsigned int stationSlots[NUMSTATIONS];
+
+          /* eventfds of the waiter event front end (created by the generator, inherited by all entities) */
+          /** \brief signalled by groups when a food request is queued to the waiter of each zone */
+          int foodReqEvent[MAXWAITERS];
+          /** \brief signalled by chef when a food ready notice is queued to the waiter of each zone */
+          int foodReadyEvent[MAXWAITERS];
+          /** \brief signalled by the generator when all groups have left (never consumed, seen by every waiter) */
+          int shutdownEvent;
+
+          /** \brief set by the generator when all groups have left: service entities terminate once they are woken up */
+          bool closing;
+          /** \brief set by the generator to have each helper terminate once it has nothing to do (updated atomically) */
+          bool retire[MAXHELPERS];
+
+          /* seating state, shared by the receptionists (within the critical region) */
+          /** \brief set by the first receptionist to set up the seating state */
+          bool seatingReady;
+          /** \brief receptionists view on each group evolution (see semSharedMemReceptionist.c) */
+          int groupRecord[MAXGROUPS];
+          /** \brief first free table of each capacity (-1 if none) */
+          int freeTables[MAXSEATS+1];
+          /** \brief next free table of the same capacity (-1 if none) */
+          int nextFree[MAXTABLES];
+          /** \brief previous free table of the same capacity (-1 if none) */
+          int prevFree[MAXTABLES];
+          /** \brief free tables (one bit per table) */
+          unsigned int freeMask;
+          /** \brief receptionists view on the reservation of each group (see semSharedMemReceptionist.c) */
+          int resvRecord[MAXGROUPS];
+          /** \brief tables held for the reservation of each group (one bit per table) */
+          unsigned int heldSet[MAXGROUPS];
+          /** \brief time at which the tables of each reservation were held */
+          unsigned long long heldSince[MAXGROUPS];
+          /** \brief groups that checked out at their table and whose tables are yet to be freed (one bit per group, updated atomically) */
+          unsigned int checkedOut;
+          /** \brief table-side checkout notices not yet taken by a receptionist (updated atomically) */
+          int checkoutNotes;
+          /** \brief time at which each group checked out at its table */
+          unsigned long long leftAt[MAXGROUPS];
+
+          /* watchdog bookkeeping */
+          /** \brief semaphore each entity is currently blocked on (0 if it is not blocked) */
+          unsigned int blockedOn[NUMENTITIES];
+          /** \brief id of the first entity that reported a stall plus one (0 if none) */
+          int stalled;
+
+          /* accounting */
+          /** \brief number of semaphore operations (system calls) issued by each entity, published on termination */
+          unsigned long semOps[NUMENTITIES];
+          /** \brief performance counter totals of each entity, published on termination (-1 if not available) */
+          long long perfCount[NUMENTITIES][NUMPERFCOUNTERS];
+          /** \brief downs of each entity satisfied while spinning, published on termination */
+          unsigned long spinHits[NUMENTITIES];
+          /** \brief downs of each entity that had to block, published on termination */
+          unsigned long spinMisses[NUMENTITIES];
+
+          /** \brief shadow of the semaphore values, used by spin-then-block waiting (see semSpinEnable) */
+          int semShadow[SEM_MAX+1];
+          /** \brief busy/idle accounting of the receptionists, waiter and chef (indexed by entity id, unused for groups) */
+          UTILIZATION util[NUMENTITIES];
+          /** \brief number of requests handled by each receptionist, published on termination */
+          unsigned long receptions[MAXRECEPTIONISTS];
+          /** \brief time from a table-side checkout until its tables are freed by a receptionist (updated within the critical region) */
+          LATENCY releaseLag;
+          /** \brief time-weighted number of groups waiting for a table (updated within the critical region) */
+          TIMEAVG waitingAvg;
+          /** \brief time-weighted number of occupied tables (updated within the critical region) */
+          TIMEAVG occupancyAvg;
+          /** \brief time-weighted number of occupied seats (updated within the critical region) */
+          TIMEAVG seatsAvg;
+          /** \brief latencies observed by the entities (updated atomically) */
+          LATENCY latency[NUMLATENCIES];
+          /** \brief check-in latency of the groups of each size (updated atomically) */
+          LATENCY sizeWait[MAXSEATS+1];
+          /** \brief number of groups seated at tables pushed together */
+          unsigned long combined;
+          /** \brief time at which the restaurant opened (start of operations) */
+          unsigned long long openedAt;
+          /** \brief check-in latency of walk-in groups (0) and of groups with a reservation (1) (updated atomically) */
+          LATENCY bookingWait[2];
+          /** \brief number of reservations honored, at the tables held for them or, if seated before they were held, at others */
+          unsigned long honored;
+          /** \brief number of reservations dropped because the group arrived too late or gave up */
+          unsigned long dropped;
+          /** \brief time tables were held empty for reservations, summed over the tables (in microseconds) */
+          unsigned long long heldIdle;
+          /** \brief number of groups that left on arrival, finding too many groups waiting (updated within the critical region) */
+          unsigned long balked;
+          /** \brief time groups waited for a table before leaving (updated atomically) */
+          LATENCY renegeWait;
+          /** \brief time at which the order of each group was queued to the chef (updated within the critical region) */
+          unsigned long long orderedAt[MAXGROUPS];
+          /** \brief time at which the food of each group was cooked (updated within the critical region) */
+          unsigned long long cookedAt[MAXGROUPS];
+          /** \brief number of batches cooked by the chef */
+          unsigned long batches;
+          /** \brief time spent cooking by the chef, summed over the burners (in microseconds) */
+          unsigned long long cookTime;
+          /** \brief time-weighted length of the input queue of each station but the first (updated within the critical region) */
+          TIMEAVG stationQueueAvg[NUMSTATIONS];
+          /** \brief number of times each station found the queue of the next one full */
+          unsigned long stationBlocked[NUMSTATIONS];
+          /** \brief time each station spent waiting for room in the queue of the next one (in microseconds) */
+          unsigned long long stationBlockedTime[NUMSTATIONS];
+          /** \brief number of trips made by the waiter */
+          unsigned long trips;
+          /** \brief number of requests served by the waiter in those trips */
+          unsigned long tripRequests;
+          /** \brief number of trips made by the waiter of each zone */
+          unsigned long zoneTrips[MAXWAITERS];
+          /** \brief number of requests served by the waiter of each zone */
+          unsigned long zoneRequests[MAXWAITERS];
+          /** \brief the waiter of each zone is serving requests (updated within the critical region) */
+          bool zoneBusy[MAXWAITERS];
+          /** \brief number of requests the waiter of each zone took from other zones */
+          unsigned long zoneSteals[MAXWAITERS];
+          /** \brief number of requests of each zone taken by the waiters of other zones */
+          unsigned long zoneStolen[MAXWAITERS];
+          /** \brief time-weighted number of orders queued to the chef of each dish (updated within the critical region) */
+          TIMEAVG orderQueueAvg[MAXDISHES];
+          /** \brief time from the order of each dish being queued until it is cooked (updated atomically) */
+          LATENCY dishLatency[MAXDISHES];
 
         } SHARED_DATA;
 
 /** \brief number of semaphores in the set */
-#define SEM_NU               ( 7 + sh->fSt.nGroups + 3*NUMTABLES )
+#define SEM_NU               ( 6 + sh->fSt.nGroups + 3*sh->fSt.nTables + 2*(NUMSTATIONS-1) + 2*((int)sh->fSt.nWaiters-1) + ((int)sh->fSt.nDishes-1) )
 
 #define MUTEX                  1
 #define RECEPTIONISTREQ        2
@@ -62,10 +189,14 @@ typedef struct
 #define WAITERREQUEST          4
 #define WAITERREQUESTPOSSIBLE  5
 #define WAITORDER              6
-#define ORDERRECEIVED          7
-#define WAITFORTABLE           8
+#define WAITFORTABLE           7
 #define FOODARRIVED            (WAITFORTABLE+sh->fSt.nGroups)
-#define REQUESTRECEIVED        (FOODARRIVED+NUMTABLES)
-#define TABLEDONE              (REQUESTRECEIVED+NUMTABLES)
+#define REQUESTRECEIVED        (FOODARRIVED+sh->fSt.nTables)
+#define TABLEDONE              (REQUESTRECEIVED+sh->fSt.nTables)
+#define STATIONITEMS           (TABLEDONE+sh->fSt.nTables-1)
+#define STATIONSLOTS           (STATIONITEMS+NUMSTATIONS-1)
+#define ZONEREQUEST            (STATIONSLOTS+NUMSTATIONS)
+#define ZONEREQUESTPOSSIBLE    (ZONEREQUEST+(int)sh->fSt.nWaiters-1)
+#define DISHORDER              (ZONEREQUESTPOSSIBLE+(int)sh->fSt.nWaiters-1)
 
 #endif /* SHAREDDATASYNC_H_ */
@@ -0,0 +1,254 @@
+/**
+ *  \file watchdog.c (implementation file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  \brief Stall detection on the blocking operations of the intervening entities.
+ *
+ *  Every <em>down</em> carried out by an entity is done with a timeout. If it expires, the protocol is
+ *  assumed to have lost a wakeup: the full state, the value of every semaphore and the semaphore each
+ *  entity is blocked on are dumped to stderr. The entity then goes on waiting, with no timeout, or
+ *  terminates if the config asks the watchdog to abort the run.
+ *
+ *  Defined operations:
+ *     \li naming of an entity
+ *     \li telling the entities of a run
+ *     \li registration of the calling entity
+ *     \li <em>down</em> of a semaphore under watchdog supervision
+ *     \li waiting for events on an epoll instance under watchdog supervision
+ *     \li dumping the synchronization state.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "sharedDataSync.h"
+#include "semaphore.h"
+#include "logging.h"
+#include "watchdog.h"
+
+/** \brief pointer to shared memory region (NULL if no entity was registered) */
+static SHARED_DATA *sh = NULL;
+
+/** \brief id of the registered entity */
+static unsigned int self;
+
+/* internal functions */
+
+static void stall (int semgid, const char *what)
+{
+    char name[32];
+    int first = 0;
+
+    entityName(self, name);
+    fprintf(stderr, "watchdog: %s blocked for more than %u ms on %s\n",
+            name, sh->fSt.watchdogTimeout, what);
+    if (__atomic_compare_exchange_n(&sh->stalled, &first, (int) self + 1, false,
+                                    __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+        dumpSync(stderr, sh, semgid);
+    }
+    if (sh->fSt.watchdogAbort) {
+        exit (EXIT_FAILURE);
+    }
+}
+
+static void semName(unsigned int sindex, char name[])
+{
+    if (sindex == MUTEX) sprintf(name, "mutex");
+    else if (sindex == RECEPTIONISTREQ) sprintf(name, "receptionistReq");
+    else if (sindex == RECEPTIONISTREQUESTPOSSIBLE) sprintf(name, "receptionistRequestPossible");
+    else if (sindex == WAITERREQUEST) sprintf(name, "waiterRequest");
+    else if (sindex == WAITERREQUESTPOSSIBLE) sprintf(name, "waiterRequestPossible");
+    else if (sindex == WAITORDER) sprintf(name, "waitOrder");
+    else if ((int) sindex >= DISHORDER) sprintf(name, "waitOrder[%u]", sindex - DISHORDER + 1);
+    else if ((int) sindex < FOODARRIVED) sprintf(name, "waitForTable[%u]", sindex - WAITFORTABLE);
+    else if ((int) sindex < REQUESTRECEIVED) sprintf(name, "foodArrived[%u]", sindex - FOODARRIVED);
+    else if ((int) sindex < TABLEDONE) sprintf(name, "requestReceived[%u]", sindex - REQUESTRECEIVED);
+    else if ((int) sindex < TABLEDONE + sh->fSt.nTables) sprintf(name, "tableDone[%u]", sindex - TABLEDONE);
+    else if ((int) sindex < STATIONSLOTS + 1) sprintf(name, "stationItems[%u]", sindex - STATIONITEMS);
+    else if ((int) sindex < ZONEREQUEST) sprintf(name, "stationSlots[%u]", sindex - STATIONSLOTS);
+    else if ((int) sindex < ZONEREQUESTPOSSIBLE) sprintf(name, "waiterRequest[%u]", sindex - ZONEREQUEST + 1);
+    else sprintf(name, "waiterRequestPossible[%u]", sindex - ZONEREQUESTPOSSIBLE + 1);
+}
+
+/* external functions */
+
+/**
+ *  \brief Short name of an entity, as used in the error file names (RT, WT, CH, PR, PL, Gnn, RTn, WTn, CHn, HPn).
+ *
+ *  \param entity entity id
+ *  \param name location where the name is stored (at least 4 characters)
+ */
+void entityName (unsigned int entity, char name[])
+{
+    switch (entity) {
+        case RECEPTIONIST_ID: sprintf(name, "RT"); break;
+        case WAITER_ID:       sprintf(name, "WT"); break;
+        case CHEF_ID:         sprintf(name, "CH"); break;
+        case PREP_ID:         sprintf(name, "PR"); break;
+        case PLATE_ID:        sprintf(name, "PL"); break;
+        default:
+            if (entity >= HELPERS_ID) sprintf(name, "HP%u", entity - HELPERS_ID);
+            else if (entity >= CHEFS_ID) sprintf(name, "CH%u", entity - CHEFS_ID + 1);
+            else if (entity >= WAITERS_ID) sprintf(name, "WT%u", entity - WAITERS_ID + 1);
+            else if (entity >= RECEPTIONISTS_ID) sprintf(name, "RT%u", entity - RECEPTIONISTS_ID + 1);
+            else sprintf(name, "G%02u", entity - GROUP_ID);
+            break;
+    }
+}
+
+/**
+ *  \brief Whether an entity id is used in a run (service roles always are, even if not started).
+ *
+ *  \param p_fSt pointer to the full state of the problem
+ *  \param entity entity id
+ *
+ *  \return true if the entity is a service role, a group, an extra receptionist, waiter or chef or a helper
+ *          spawned in the run
+ */
+bool entityInRun (FULL_STAT *p_fSt, unsigned int entity)
+{
+    if (entity >= HELPERS_ID) return entity - HELPERS_ID < p_fSt->nHelpers;
+    if (entity >= CHEFS_ID) return entity - CHEFS_ID + 1 < p_fSt->nDishes;
+    if (entity >= WAITERS_ID) return entity - WAITERS_ID + 1 < p_fSt->nWaiters;
+    if (entity >= RECEPTIONISTS_ID) return entity - RECEPTIONISTS_ID + 1 < p_fSt->nReceptionists;
+    return entity < GROUP_ID + (unsigned int) p_fSt->nGroups;
+}
+
+/**
+ *  \brief Registration of the calling entity.
+ *
+ *  Must be called once the shared region is mapped and before any supervised <em>down</em>.
+ *
+ *  \param p_sh pointer to the shared memory region
+ *  \param entity id of the calling entity
+ */
+void watchdogInit (SHARED_DATA *p_sh, unsigned int entity)
+{
+    sh = p_sh;
+    self = entity;
+    sh->blockedOn[self] = 0;
+}
+
+/**
+ *  \brief <em>Down</em> of a semaphore within the set, under watchdog supervision.
+ *
+ *  Same semantics as semDown. If the entity stays blocked longer than the configured timeout, the
+ *  synchronization state is dumped and the entity goes on waiting with no timeout (or, if the watchdog
+ *  aborts the run, the process exits with failure status).
+ *  Only the first entity to detect the stall dumps the whole state; the others just report where
+ *  they were blocked.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int semDownWatched (int semgid, unsigned int sindex)
+{
+    char name[32], what[48];
+    int ret;
+
+    if ((sh == NULL) || (sh->fSt.watchdogTimeout == 0)) {
+        return semDown (semgid, sindex);
+    }
+
+    sh->blockedOn[self] = sindex;
+    ret = semDownTimed (semgid, sindex, sh->fSt.watchdogTimeout * 1000U);
+    if ((ret == -1) && (errno == EAGAIN)) {
+        semName(sindex, name);
+        sprintf(what, "semaphore %u (%s)", sindex, name);
+        stall(semgid, what);
+        ret = semDown (semgid, sindex);
+    }
+    sh->blockedOn[self] = 0;
+
+    return ret;
+}
+
+/**
+ *  \brief Waiting for events on an epoll instance, under watchdog supervision.
+ *
+ *  Same semantics as <tt>epoll_wait</tt> with no timeout, except that interrupted waits are resumed.
+ *  If no event arrives within the configured timeout, the stall is handled as in semDownWatched.
+ *
+ *  \param semgid set identifier (only used to dump the semaphores on a stall)
+ *  \param epfd epoll instance
+ *  \param ev location where the ready events are stored
+ *  \param maxEv maximum number of events to be returned
+ *
+ *  \return number of ready events, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int eventWaitWatched (int semgid, int epfd, struct epoll_event *ev, int maxEv)
+{
+    int timeout = -1;
+    int ret;
+
+    if ((sh != NULL) && (sh->fSt.watchdogTimeout != 0)) {
+        timeout = (int) sh->fSt.watchdogTimeout;
+        sh->blockedOn[self] = EVENTWAIT;
+    }
+    do {
+        ret = epoll_wait (epfd, ev, maxEv, timeout);
+    } while ((ret == -1) && (errno == EINTR));
+    if (ret == 0) {
+        stall(semgid, "its event descriptors");
+        do {
+            ret = epoll_wait (epfd, ev, maxEv, -1);
+        } while ((ret == -1) && (errno == EINTR));
+    }
+    if (sh != NULL) {
+        sh->blockedOn[self] = 0;
+    }
+
+    return ret;
+}
+
+/**
+ *  \brief Dumping the synchronization state.
+ *
+ *  Writes the full state of the problem, the value and number of waiters of every semaphore in the
+ *  set and the entities blocked on it.
+ *
+ *  \param fic open stream
+ *  \param p_sh pointer to the shared memory region
+ *  \param semgid set identifier
+ */
+void dumpSync (FILE *fic, SHARED_DATA *p_sh, int semgid)
+{
+    char name[32];
+    unsigned int s, e;
+
+    sh = p_sh;
+
+    fprintf(fic, "---- full state ----\n");
+    dumpState(fic, &sh->fSt);
+
+    fprintf(fic, "---- semaphores ----\n");
+    fprintf(fic, "%4s %-28s %6s %6s  %s\n", "idx", "name", "value", "ncnt", "blocked entities");
+    for (s = 1; s <= (unsigned int) SEM_NU; s++) {
+        semName(s, name);
+        fprintf(fic, "%4u %-28s %6d %6d ", s, name, semGetValue(semgid, s), semGetWaiting(semgid, s));
+        for (e = 0; e < NUMENTITIES; e++) {
+            if (entityInRun(&sh->fSt, e) && (sh->blockedOn[e] == s)) {
+                entityName(e, name);
+                fprintf(fic, " %s", name);
+            }
+        }
+        fprintf(fic, "\n");
+    }
+    for (e = 0; e < NUMENTITIES; e++) {
+        if (entityInRun(&sh->fSt, e) && (sh->blockedOn[e] == EVENTWAIT)) {
+            entityName(e, name);
+            fprintf(fic, "%4s %-28s %6s %6s  %s\n", "-", "eventfds", "-", "-", name);
+        }
+    }
+    fflush(fic);
+}
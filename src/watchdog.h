@@ -0,0 +1,105 @@
+/**
+ *  \file watchdog.h (interface file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  \brief Stall detection on the blocking operations of the intervening entities.
+ *
+ *  Every <em>down</em> carried out by an entity is done with a timeout. If it expires, the protocol is
+ *  assumed to have lost a wakeup: the full state, the value of every semaphore and the semaphore each
+ *  entity is blocked on are dumped to stderr. The entity then goes on waiting, with no timeout, or
+ *  terminates if the config asks the watchdog to abort the run.
+ *
+ *  Defined operations:
+ *     \li naming of an entity
+ *     \li telling the entities of a run
+ *     \li registration of the calling entity
+ *     \li <em>down</em> of a semaphore under watchdog supervision
+ *     \li waiting for events on an epoll instance under watchdog supervision
+ *     \li dumping the synchronization state.
+ */
+
+#ifndef WATCHDOG_H_
+#define WATCHDOG_H_
+
+#include <stdio.h>
+#include <sys/epoll.h>
+
+#include "sharedDataSync.h"
+
+/** \brief pseudo semaphore index recorded for an entity waiting on its event descriptors */
+#define EVENTWAIT  0xffffU
+
+/**
+ *  \brief Short name of an entity, as used in the error file names (RT, WT, CH, PR, PL, Gnn, RTn, WTn, CHn, HPn).
+ *
+ *  \param entity entity id
+ *  \param name location where the name is stored (at least 4 characters)
+ */
+extern void entityName (unsigned int entity, char name[]);
+
+/**
+ *  \brief Whether an entity id is used in a run (service roles always are, even if not started).
+ *
+ *  \param p_fSt pointer to the full state of the problem
+ *  \param entity entity id
+ *
+ *  \return true if the entity is a service role, a group, an extra receptionist, waiter or chef or a helper
+ *          spawned in the run
+ */
+extern bool entityInRun (FULL_STAT *p_fSt, unsigned int entity);
+
+/**
+ *  \brief Registration of the calling entity.
+ *
+ *  Must be called once the shared region is mapped and before any supervised <em>down</em>.
+ *
+ *  \param p_sh pointer to the shared memory region
+ *  \param entity id of the calling entity
+ */
+extern void watchdogInit (SHARED_DATA *p_sh, unsigned int entity);
+
+/**
+ *  \brief <em>Down</em> of a semaphore within the set, under watchdog supervision.
+ *
+ *  Same semantics as semDown. If the entity stays blocked longer than the configured timeout, the
+ *  synchronization state is dumped and the entity goes on waiting with no timeout (or, if the watchdog
+ *  aborts the run, the process exits with failure status).
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+extern int semDownWatched (int semgid, unsigned int sindex);
+
+/**
+ *  \brief Waiting for events on an epoll instance, under watchdog supervision.
+ *
+ *  Same semantics as <tt>epoll_wait</tt> with no timeout, except that interrupted waits are resumed.
+ *  If no event arrives within the configured timeout, the stall is handled as in semDownWatched.
+ *
+ *  \param semgid set identifier (only used to dump the semaphores on a stall)
+ *  \param epfd epoll instance
+ *  \param ev location where the ready events are stored
+ *  \param maxEv maximum number of events to be returned
+ *
+ *  \return number of ready events, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+extern int eventWaitWatched (int semgid, int epfd, struct epoll_event *ev, int maxEv);
+
+/**
+ *  \brief Dumping the synchronization state.
+ *
+ *  Writes the full state of the problem, the value and number of waiters of every semaphore in the
+ *  set and the entities blocked on it.
+ *
+ *  \param fic open stream
+ *  \param p_sh pointer to the shared memory region
+ *  \param semgid set identifier
+ */
+extern void dumpSync (FILE *fic, SHARED_DATA *p_sh, int semgid);
+
+#endif /* WATCHDOG_H_ */